@@ -0,0 +1,366 @@
+// End-to-end load generator: opens many loopback connections to a running server, joins
+// channels whose sizes follow a Zipf distribution and drives channel and private /msg
+// traffic at a fixed rate. Every message carries its send timestamp, so receivers can
+// report delivery latency.
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "LatencyHistogram.h"
+#include "LatencyMetrics.h"
+#include "LineBuffer.h"
+
+namespace {
+    constexpr std::string_view MARKER = "bench ";
+    constexpr size_t MAX_LINE_LENGTH = 8192;
+    constexpr size_t MAX_PENDING_OUTPUT = 64 * 1024;
+
+    struct Options {
+        std::string host = "127.0.0.1";
+        int port = 4040;
+        int users = 5000;
+        int channels = 200;
+        int joinsPerUser = 2;
+        double zipfExponent = 1.0;
+        double rate = 20000;
+        double privateRatio = 0.1;
+        int threads = 4;
+        int durationSeconds = 10;
+        int warmupSeconds = 2;
+    };
+
+    struct Connection {
+        int socket = -1;
+        int userId = 0;
+        std::vector<int> channels;
+        LineBuffer input;
+        std::string pendingOutput;
+    };
+
+    // Everything one generator thread measures; only the main thread reads it, and only
+    // through the atomics and after join().
+    struct WorkerStats {
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> bytesReceived{0};
+        std::atomic<uint64_t> sendStalls{0};
+        LatencyHistogram latency;
+    };
+
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options]\n"
+                  << "  --host <addr>          Server address (127.0.0.1)\n"
+                  << "  --port <port>          Server port (4040)\n"
+                  << "  --users <n>            Connections to open (5000)\n"
+                  << "  --channels <n>         Channels to spread users over (200)\n"
+                  << "  --joins <n>            Channels joined per user (2)\n"
+                  << "  --zipf <s>             Zipf exponent of channel popularity, 0 = uniform (1.0)\n"
+                  << "  --rate <msgs/s>        Total messages sent per second (20000)\n"
+                  << "  --private <ratio>      Share of private messages (0.1)\n"
+                  << "  --threads <n>          Generator threads (4)\n"
+                  << "  --duration <s>         Measured seconds (10)\n"
+                  << "  --warmup <s>           Unmeasured seconds before that (2)\n";
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help" || i + 1 >= argc) {
+                return false;
+            }
+            const std::string value = argv[++i];
+            if (arg == "--host") options.host = value;
+            else if (arg == "--port") options.port = std::stoi(value);
+            else if (arg == "--users") options.users = std::stoi(value);
+            else if (arg == "--channels") options.channels = std::stoi(value);
+            else if (arg == "--joins") options.joinsPerUser = std::stoi(value);
+            else if (arg == "--zipf") options.zipfExponent = std::stod(value);
+            else if (arg == "--rate") options.rate = std::stod(value);
+            else if (arg == "--private") options.privateRatio = std::stod(value);
+            else if (arg == "--threads") options.threads = std::stoi(value);
+            else if (arg == "--duration") options.durationSeconds = std::stoi(value);
+            else if (arg == "--warmup") options.warmupSeconds = std::stoi(value);
+            else return false;
+        }
+        return options.users > 0 && options.channels > 0 && options.threads > 0 &&
+               options.joinsPerUser > 0 && options.joinsPerUser <= options.channels;
+    }
+
+    void raiseFileLimit() {
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    int connectTo(const sockaddr_in& address) {
+        const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1) return -1;
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {
+            close(fd);
+            return -1;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    void flush(Connection& connection, WorkerStats& stats) {
+        while (!connection.pendingOutput.empty()) {
+            const ssize_t sent = send(connection.socket, connection.pendingOutput.data(), connection.pendingOutput.size(), MSG_NOSIGNAL);
+            if (sent <= 0) {
+                if (sent < 0 && errno == EINTR) continue;
+                stats.sendStalls.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            connection.pendingOutput.erase(0, static_cast<size_t>(sent));
+        }
+    }
+
+    // Delivered lines look like "<nick@#channel> bench <ns>" or "*Private from nick: bench <ns>";
+    // the sender's own "*Private to" echo is not a delivery.
+    void onLine(std::string_view line, WorkerStats& stats, bool measuring) {
+        if (line.starts_with("*Private to ")) return;
+        const size_t marker = line.find(MARKER);
+        if (marker == std::string_view::npos) return;
+        const std::string_view digits = line.substr(marker + MARKER.size());
+        uint64_t sentAt = 0;
+        if (std::from_chars(digits.data(), digits.data() + digits.size(), sentAt).ec != std::errc()) return;
+        if (!measuring) return;
+        const uint64_t now = LatencyMetrics::now();
+        stats.delivered.fetch_add(1, std::memory_order_relaxed);
+        stats.latency.record(now > sentAt ? now - sentAt : 0);
+    }
+
+    class ZipfSampler {
+    public:
+        ZipfSampler(int count, double exponent) : cumulative_(count) {
+            double total = 0;
+            for (int rank = 0; rank < count; ++rank) {
+                total += 1.0 / std::pow(rank + 1, exponent);
+                cumulative_[rank] = total;
+            }
+            for (double& value : cumulative_) {
+                value /= total;
+            }
+        }
+
+        template <typename Random>
+        int operator()(Random& random) const {
+            const double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+            return static_cast<int>(std::lower_bound(cumulative_.begin(), cumulative_.end(), u) - cumulative_.begin());
+        }
+
+    private:
+        std::vector<double> cumulative_;
+    };
+
+    class Worker {
+    public:
+        Worker(const Options& options, int index, WorkerStats& stats)
+            : options_(options), index_(index), stats_(stats), random_(index * 7919 + 1) {}
+
+        bool connectUsers(const sockaddr_in& address, const ZipfSampler& zipf) {
+            epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (epollFd_ == -1) return false;
+            for (int user = index_; user < options_.users; user += options_.threads) {
+                Connection connection;
+                connection.socket = connectTo(address);
+                if (connection.socket == -1) {
+                    std::cerr << "connect failed for user " << user << ": " << std::strerror(errno) << std::endl;
+                    return false;
+                }
+                connection.userId = user;
+                connection.pendingOutput = "/nick bu" + std::to_string(user) + "\n";
+                while (static_cast<int>(connection.channels.size()) < options_.joinsPerUser) {
+                    const int channel = zipf(random_);
+                    if (std::find(connection.channels.begin(), connection.channels.end(), channel) == connection.channels.end()) {
+                        connection.channels.push_back(channel);
+                        connection.pendingOutput += "/join #bc" + std::to_string(channel) + "\n";
+                    }
+                }
+                connections_.push_back(std::make_unique<Connection>(std::move(connection)));
+                Connection& added = *connections_.back();
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.ptr = &added;
+                epoll_ctl(epollFd_, EPOLL_CTL_ADD, added.socket, &event);
+                flush(added, stats_);
+            }
+            return true;
+        }
+
+        void run(std::chrono::steady_clock::time_point startAt, std::chrono::steady_clock::time_point measureAt,
+                 std::chrono::steady_clock::time_point endAt) {
+            const double ratePerThread = options_.rate / options_.threads;
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            std::uniform_int_distribution<size_t> pickConnection(0, connections_.empty() ? 0 : connections_.size() - 1);
+            std::uniform_int_distribution<int> pickUser(0, options_.users - 1);
+            uint64_t scheduled = 0;
+            epoll_event events[256];
+
+            while (std::chrono::steady_clock::now() < endAt) {
+                const auto now = std::chrono::steady_clock::now();
+                const bool measuring = now >= measureAt;
+                if (now >= startAt && !connections_.empty()) {
+                    const double elapsed = std::chrono::duration<double>(now - startAt).count();
+                    const auto due = static_cast<uint64_t>(elapsed * ratePerThread);
+                    for (; scheduled < due; ++scheduled) {
+                        Connection& sender = *connections_[pickConnection(random_)];
+                        if (sender.pendingOutput.size() > MAX_PENDING_OUTPUT) continue;
+                        const std::string stamp = std::string(MARKER) + std::to_string(LatencyMetrics::now());
+                        if (coin(random_) < options_.privateRatio) {
+                            sender.pendingOutput += "/msg bu" + std::to_string(pickUser(random_)) + " " + stamp + "\n";
+                        } else {
+                            const int channel = sender.channels[scheduled % sender.channels.size()];
+                            sender.pendingOutput += "/msg #bc" + std::to_string(channel) + " " + stamp + "\n";
+                        }
+                        flush(sender, stats_);
+                        if (measuring) {
+                            stats_.sent.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+
+                const int ready = epoll_wait(epollFd_, events, 256, 1);
+                for (int i = 0; i < ready; ++i) {
+                    readFrom(*static_cast<Connection*>(events[i].data.ptr), measuring);
+                }
+                for (auto& connection : connections_) {
+                    if (!connection->pendingOutput.empty()) flush(*connection, stats_);
+                }
+            }
+        }
+
+        ~Worker() {
+            for (auto& connection : connections_) {
+                close(connection->socket);
+            }
+            if (epollFd_ != -1) close(epollFd_);
+        }
+
+    private:
+        void readFrom(Connection& connection, bool measuring) {
+            char buffer[16384];
+            while (true) {
+                const ssize_t received = recv(connection.socket, buffer, sizeof(buffer), 0);
+                if (received <= 0) {
+                    if (received < 0 && errno == EINTR) continue;
+                    return;
+                }
+                if (measuring) {
+                    stats_.bytesReceived.fetch_add(static_cast<uint64_t>(received), std::memory_order_relaxed);
+                }
+                connection.input.feed(buffer, static_cast<size_t>(received), MAX_LINE_LENGTH, [&](std::string_view line) {
+                    onLine(line, stats_, measuring);
+                    return true;
+                });
+            }
+        }
+
+        const Options& options_;
+        const int index_;
+        WorkerStats& stats_;
+        std::mt19937_64 random_;
+        int epollFd_ = -1;
+        std::vector<std::unique_ptr<Connection>> connections_;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        if (!parseOptions(argc, argv, options)) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option value: " << e.what() << std::endl;
+        return 1;
+    }
+    raiseFileLimit();
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Invalid host " << options.host << std::endl;
+        return 1;
+    }
+
+    std::cout << "Connecting " << options.users << " users over " << options.channels << " channels (zipf "
+              << options.zipfExponent << ", " << options.joinsPerUser << " joins each)..." << std::endl;
+    const ZipfSampler zipf(options.channels, options.zipfExponent);
+    std::vector<std::unique_ptr<WorkerStats>> stats;
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < options.threads; ++i) {
+        stats.push_back(std::make_unique<WorkerStats>());
+        workers.push_back(std::make_unique<Worker>(options, i, *stats.back()));
+        if (!workers.back()->connectUsers(address, zipf)) {
+            return 1;
+        }
+    }
+
+    // Give the server a moment to process the joins before traffic starts.
+    const auto startAt = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    const auto measureAt = startAt + std::chrono::seconds(options.warmupSeconds);
+    const auto endAt = measureAt + std::chrono::seconds(options.durationSeconds);
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker, startAt, measureAt, endAt] { worker->run(startAt, measureAt, endAt); });
+    }
+
+    uint64_t lastDelivered = 0;
+    while (std::chrono::steady_clock::now() + std::chrono::seconds(1) <= endAt) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        uint64_t delivered = 0;
+        for (const auto& worker : stats) delivered += worker->delivered.load(std::memory_order_relaxed);
+        if (std::chrono::steady_clock::now() >= measureAt) {
+            std::cout << "  delivered/s " << (delivered - lastDelivered) << std::endl;
+        }
+        lastDelivered = delivered;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto latency = std::make_unique<LatencyHistogram::Snapshot>();
+    uint64_t sent = 0, delivered = 0, bytesReceived = 0, sendStalls = 0;
+    for (const auto& worker : stats) {
+        sent += worker->sent.load();
+        delivered += worker->delivered.load();
+        bytesReceived += worker->bytesReceived.load();
+        sendStalls += worker->sendStalls.load();
+        latency->add(worker->latency);
+    }
+    const double seconds = options.durationSeconds;
+    constexpr double NANOS_PER_MICRO = 1000.0;
+    std::cout << "Sent:           " << sent / seconds << " msgs/s (" << sent << " total, " << sendStalls << " send stalls)\n"
+              << "Delivered:      " << delivered / seconds << " msgs/s (" << delivered << " total)\n"
+              << "Received:       " << bytesReceived / seconds / (1024 * 1024) << " MiB/s\n"
+              << "Latency (us):   p50 " << latency->percentile(0.50) / NANOS_PER_MICRO
+              << "  p99 " << latency->percentile(0.99) / NANOS_PER_MICRO
+              << "  p999 " << latency->percentile(0.999) / NANOS_PER_MICRO
+              << "  max " << latency->max / NANOS_PER_MICRO << std::endl;
+    return 0;
+}
\ No newline at end of file
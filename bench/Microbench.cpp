@@ -0,0 +1,269 @@
+// In-process microbenchmarks for the hot paths: input framing, command tokenizing,
+// MessageManager dispatch and channel/server-wide fan-out. Clients are fake: either
+// reactorless (output is drained between timed batches) or registered with real
+// reactors on an eventfd, whose "writes" just discard the queued output.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "Channel.h"
+#include "ChannelManager.h"
+#include "Client.h"
+#include "ClientManager.h"
+#include "CommandLine.h"
+#include "LineBuffer.h"
+#include "MessageManager.h"
+#include "Reactor.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr auto MIN_MEASURE_TIME = std::chrono::milliseconds(300);
+    constexpr size_t MEMBER_COUNTS[] = {1, 10, 100, 1000, 10000};
+    constexpr size_t THREAD_COUNTS[] = {1, 2, 4, 8};
+    constexpr size_t SCALING_MEMBERS = 1000;
+
+    void report(const std::string& name, double nsPerOp, const std::string& extra = "") {
+        std::printf("%-44s %12.1f ns/op  %s\n", name.c_str(), nsPerOp, extra.c_str());
+        std::fflush(stdout);
+    }
+
+    std::string perItem(double ns, size_t items, const char* unit) {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%.1f ns/%s", ns / items, unit);
+        return buffer;
+    }
+
+    // Runs `op` in batches until MIN_MEASURE_TIME of timed work has accumulated; `reset`
+    // runs untimed between batches (e.g. to drain the fake clients' output queues).
+    double measure(size_t batch, const std::function<void()>& op, const std::function<void()>& reset = {}) {
+        for (size_t i = 0; i < batch; ++i) op();
+        if (reset) reset();
+        Clock::duration elapsed{};
+        size_t operations = 0;
+        while (elapsed < MIN_MEASURE_TIME) {
+            const auto start = Clock::now();
+            for (size_t i = 0; i < batch; ++i) op();
+            elapsed += Clock::now() - start;
+            operations += batch;
+            if (reset) reset();
+        }
+        return std::chrono::duration<double, std::nano>(elapsed).count() / operations;
+    }
+
+    size_t batchFor(size_t recipients) {
+        return std::max<size_t>(1, 20000 / recipients);
+    }
+
+    struct Core {
+        ClientManager clients{static_cast<int>(MEMBER_COUNTS[std::size(MEMBER_COUNTS) - 1] + 16)};
+        ChannelManager channels{1000};
+        MessageManager messages{clients, channels};
+        std::vector<std::shared_ptr<Client>> fakes;
+
+        std::shared_ptr<Client> addFake(int socket = -1) {
+            auto client = Client::create(socket);
+            client->setNickname("fake" + std::to_string(fakes.size()));
+            clients.addClient(client);
+            fakes.push_back(client);
+            return client;
+        }
+
+        void drain() const {
+            for (const auto& client : fakes) {
+                client->consumeOutput(client->getQueuedBytes());
+            }
+        }
+    };
+
+    void benchFraming() {
+        const std::string line(63, 'x');
+        std::string chunk;
+        while (chunk.size() + line.size() + 1 <= 16384) {
+            chunk += line;
+            chunk += '\n';
+        }
+        const size_t linesPerChunk = chunk.size() / (line.size() + 1);
+
+        LineBuffer buffer;
+        size_t lines = 0;
+        auto countLine = [&lines](std::string_view) { ++lines; return true; };
+        double ns = measure(100, [&] { buffer.feed(chunk.data(), chunk.size(), 8192, countLine); });
+        report("framing/whole_lines_16k", ns, perItem(ns, linesPerChunk, "line"));
+
+        // MTU-sized reads that split lines, so the partial-line copy path is exercised.
+        constexpr size_t SEGMENT = 1448;
+        ns = measure(100, [&] {
+            for (size_t offset = 0; offset < chunk.size(); offset += SEGMENT) {
+                buffer.feed(chunk.data() + offset, std::min(SEGMENT, chunk.size() - offset), 8192, countLine);
+            }
+        });
+        report("framing/split_segments_16k", ns, perItem(ns, linesPerChunk, "line"));
+    }
+
+    void benchCommandLine() {
+        size_t sink = 0;
+        double ns = measure(10000, [&] {
+            const CommandLine command("/msg #general hello there, how is everyone doing today?");
+            sink += command.getArgCount() + command.getTrailing(1).size();
+        });
+        report("commandline/msg", ns);
+        ns = measure(10000, [&] {
+            const CommandLine command("/join #general");
+            sink += command.getArgCount();
+        });
+        report("commandline/join", ns);
+        if (sink == 0) std::puts("");
+    }
+
+    void benchChannelFanout() {
+        for (size_t members : MEMBER_COUNTS) {
+            Core core;
+            const std::string channelName = "#bench";
+            core.channels.createChannel(channelName);
+            for (size_t i = 0; i < members; ++i) {
+                core.channels.joinChannel(core.addFake(), channelName);
+            }
+            const auto channel = core.channels.getChannel(channelName);
+            const PayloadRef payload = MessagePayload::create("<fake0@#bench> hello there\n");
+            const double ns = measure(batchFor(members), [&] { channel->broadcastMessage(payload); }, [&] { core.drain(); });
+            report("channel_broadcast/members=" + std::to_string(members), ns, perItem(ns, members, "recipient"));
+        }
+    }
+
+    void benchHandleMessage() {
+        for (size_t members : MEMBER_COUNTS) {
+            Core core;
+            const std::string channelName = "#bench";
+            core.channels.createChannel(channelName);
+            for (size_t i = 0; i < members; ++i) {
+                core.channels.joinChannel(core.addFake(), channelName);
+            }
+            const auto sender = core.fakes.front();
+            sender->setActiveChannel(core.channels.getChannel(channelName)->getId());
+            const double ns = measure(batchFor(members), [&] { core.messages.handleMessage(sender, "hello there"); }, [&] { core.drain(); });
+            report("handle_message/members=" + std::to_string(members), ns, perItem(ns, members, "recipient"));
+        }
+    }
+
+    void benchServerBroadcast() {
+        for (size_t count : MEMBER_COUNTS) {
+            Core core;
+            for (size_t i = 0; i < count; ++i) {
+                core.addFake();
+            }
+            const double ns = measure(batchFor(count), [&] { core.clients.broadcastMessage("*** server notice"); }, [&] { core.drain(); });
+            report("client_manager_broadcast/clients=" + std::to_string(count), ns, perItem(ns, count, "recipient"));
+        }
+    }
+
+    // `threads` sender threads push channel messages through MessageManager while as many
+    // reactors deliver them to SCALING_MEMBERS eventfd-backed members.
+    void benchThreadScaling(size_t threads) {
+        Core core;
+        std::vector<std::unique_ptr<Reactor>> reactors;
+        std::atomic<uint64_t> delivered{0};
+        for (size_t i = 0; i < threads; ++i) {
+            auto reactor = std::make_unique<Reactor>(i, IoBackend::Epoll);
+            reactor->setOnWritableCallback([&delivered](const std::shared_ptr<Client>& client) {
+                delivered.fetch_add(client->getQueuedMessageCount(), std::memory_order_relaxed);
+                client->consumeOutput(client->getQueuedBytes());
+            });
+            reactors.push_back(std::move(reactor));
+        }
+        const std::string channelName = "#scaling";
+        core.channels.createChannel(channelName);
+        for (size_t i = 0; i < SCALING_MEMBERS; ++i) {
+            auto client = core.addFake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+            reactors[i % threads]->addClient(client);
+            core.channels.joinChannel(client, channelName);
+        }
+
+        std::vector<std::thread> reactorThreads;
+        for (auto& reactor : reactors) {
+            reactorThreads.emplace_back([&reactor] { reactor->run(); });
+        }
+
+        std::atomic<bool> sending{true};
+        std::atomic<uint64_t> sent{0};
+        std::vector<std::thread> senders;
+        const auto start = Clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            senders.emplace_back([&, t] {
+                const auto sender = core.fakes[t];
+                sender->setActiveChannel(core.channels.getChannel(channelName)->getId());
+                uint64_t count = 0;
+                while (sending.load(std::memory_order_relaxed)) {
+                    core.messages.handleMessage(sender, "hello from a sender thread");
+                    ++count;
+                }
+                sent.fetch_add(count);
+            });
+        }
+        std::this_thread::sleep_for(MIN_MEASURE_TIME);
+        sending = false;
+        for (auto& sender : senders) {
+            sender.join();
+        }
+        // Throughput counts until every queued delivery has actually been written.
+        const uint64_t expected = sent.load() * SCALING_MEMBERS;
+        const auto deadline = Clock::now() + std::chrono::seconds(30);
+        while (delivered.load() < expected && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (auto& reactor : reactors) {
+            reactor->stop();
+        }
+        for (auto& thread : reactorThreads) {
+            thread.join();
+        }
+        reactors.clear();
+        for (const auto& client : core.fakes) {
+            close(client->getSocket());
+        }
+
+        char extra[96];
+        std::snprintf(extra, sizeof(extra), "%.0f msgs/s, %.0f deliveries/s", sent.load() / seconds, delivered.load() / seconds);
+        report("fanout_scaling/threads=" + std::to_string(threads), seconds * 1e9 / std::max<uint64_t>(sent.load(), 1), extra);
+    }
+
+    void raiseFileLimit() {
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const std::string filter = argc > 1 ? argv[1] : "";
+    auto selected = [&filter](const char* group) { return filter.empty() || filter == group; };
+    raiseFileLimit();
+    // Channel joins are logged to std::clog; keep the results readable.
+    std::clog.rdbuf(nullptr);
+
+    if (selected("framing")) benchFraming();
+    if (selected("commandline")) benchCommandLine();
+    if (selected("channel")) benchChannelFanout();
+    if (selected("handle")) benchHandleMessage();
+    if (selected("broadcast")) benchServerBroadcast();
+    if (selected("scaling")) {
+        for (size_t threads : THREAD_COUNTS) {
+            benchThreadScaling(threads);
+        }
+    }
+    return 0;
+}
\ No newline at end of file
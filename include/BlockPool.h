@@ -0,0 +1,46 @@
+#ifndef BLOCKPOOL_H
+#define BLOCKPOOL_H
+
+#include <cstddef>
+#include <new>
+
+// Size-class slab allocator for the objects churned per connection and per message:
+// clients, output queue chunks, mailbox deliveries and message payloads. Blocks are
+// carved from 64 KiB slabs that are never returned to malloc, and every thread keeps a
+// small cache per size class, so the common allocate/free pair takes no lock.
+// Requests above MAX_POOLED_SIZE go straight to operator new.
+class BlockPool {
+public:
+    static constexpr size_t MAX_POOLED_SIZE = 4096;
+    static constexpr size_t BLOCK_ALIGNMENT = 16;
+
+    static void* allocate(size_t bytes);
+    // `bytes` must be the size that was passed to allocate().
+    static void deallocate(void* block, size_t bytes) noexcept;
+};
+
+// Standard allocator over BlockPool, for std::allocate_shared and containers.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    static_assert(alignof(T) <= BlockPool::BLOCK_ALIGNMENT, "BlockPool only guarantees 16-byte alignment");
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(BlockPool::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count) noexcept {
+        BlockPool::deallocate(pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+};
+
+#endif //BLOCKPOOL_H
\ No newline at end of file
@@ -2,34 +2,79 @@
 #define CHANNEL_H
 
 #include <string>
-#include <unordered_set>
 #include <memory>
 #include <mutex>
+#include <atomic>
 #include <vector>
 
 #include "Client.h"
+#include "MessagePayload.h"
+#include "ChannelHistory.h"
 
+// Members are published as an immutable snapshot that is swapped on join/part, so
+// broadcasters iterate a contiguous array of raw pointers without taking the channel
+// lock or a refcount per member. The channel owns its members; a member that leaves is
+// handed to the snapshot it was last listed in, and every replaced snapshot keeps its
+// successor alive, so a client lives as long as any snapshot that still lists it.
+// Loading the snapshot is not lock-free on libstdc++: std::atomic<std::shared_ptr> holds
+// an internal spin bit for the one refcount increment.
 class Channel {
 public:
-    explicit Channel(std::string name);
+    using MemberList = std::vector<Client*>;
+
+    // Without a budget (or with zero lines per channel) the channel keeps no history.
+    Channel(std::string name, ChannelId id, HistoryBudget* historyBudget = nullptr);
 
     size_t getMemberCount() const;
+    bool hasMember(const Client& client) const;
     std::vector<std::string> getMemberNicknames() const;
 
     Channel(const Channel&) = delete;
     Channel& operator=(const Channel&) = delete;
+    ~Channel();
 
     const std::string& getName() const;
+    ChannelId getId() const;
 
     void addClient(std::shared_ptr<Client> client);
     void removeClient(std::shared_ptr<Client> client);
+    // Publishes one new snapshot for the whole batch.
+    void addClients(const std::vector<std::shared_ptr<Client>>& clients);
 
     void broadcastMessage(const std::string& message);
+    void broadcastMessage(const PayloadRef& message);
+
+    // Owns every listed client for as long as it is held.
+    std::shared_ptr<const MemberList> getMembers() const;
+
+    bool hasHistory() const;
+    void recordHistory(PayloadRef line);
+    // Oldest first; empty when history is disabled.
+    std::vector<PayloadRef> getHistory() const;
 
 private:
+    struct Snapshot {
+        MemberList members;
+        // Written once, by the writer that replaces this snapshot; never read by broadcasters.
+        std::vector<std::shared_ptr<Client>> retired;
+        std::shared_ptr<Snapshot> next;
+
+        ~Snapshot();
+    };
+
+    // Caller holds members_mutex_.
+    void publish(MemberList members, std::vector<std::shared_ptr<Client>> retired);
+
     std::string name_;
-    std::unordered_set<std::shared_ptr<Client>> members_;
-    mutable std::mutex members_mutex_;
+    const ChannelId id_;
+    std::atomic<std::shared_ptr<const Snapshot>> members_;
+    // Serialises writers only; readers just load the current snapshot.
+    std::mutex members_mutex_;
+    // Writer side, guarded by members_mutex_: the published snapshot and the owning
+    // references of its members, index for index.
+    std::shared_ptr<Snapshot> current_;
+    std::vector<std::shared_ptr<Client>> owners_;
+    std::unique_ptr<ChannelHistory> history_;
 };
 
 #endif //CHANNEL_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef CHANNELHISTORY_H
+#define CHANNELHISTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "MessagePayload.h"
+
+class HistoryBudget;
+
+// Fixed-capacity ring of a channel's most recent lines, kept as the shared,
+// already-formatted payloads so replaying them is just handing out references.
+class ChannelHistory {
+public:
+    ChannelHistory(size_t capacity, HistoryBudget* budget);
+    ~ChannelHistory();
+
+    ChannelHistory(const ChannelHistory&) = delete;
+    ChannelHistory& operator=(const ChannelHistory&) = delete;
+
+    void append(PayloadRef line);
+    // Oldest first. Counts as a use for LRU purposes.
+    std::vector<PayloadRef> snapshot();
+
+    size_t getBytes() const;
+    uint64_t getLastUsed() const;
+
+private:
+    friend class HistoryBudget;
+
+    // Both return the number of bytes released; the caller settles the budget.
+    size_t clear();
+    size_t trimOldest(size_t bytesWanted);
+
+    const size_t capacity_;
+    HistoryBudget* const budget_;
+
+    mutable std::mutex mutex_;
+    std::vector<PayloadRef> ring_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+    std::atomic<size_t> bytes_{0};
+    std::atomic<uint64_t> lastUsed_{0};
+};
+
+// Server-wide cap on history memory. When an append pushes the total over maxBytes,
+// the histories of the least recently used channels are dropped first; the appending
+// channel only loses its own oldest lines if nothing colder is left.
+class HistoryBudget {
+public:
+    HistoryBudget(size_t linesPerChannel, size_t maxBytes);
+
+    size_t getLinesPerChannel() const;
+    size_t getMaxBytes() const;
+    size_t getUsedBytes() const;
+    size_t getEvictionCount() const;
+
+private:
+    friend class ChannelHistory;
+
+    void registerHistory(ChannelHistory* history);
+    void unregisterHistory(ChannelHistory* history);
+    void charge(ChannelHistory* source, size_t bytes);
+    void release(size_t bytes);
+
+    const size_t linesPerChannel_;
+    const size_t maxBytes_;
+    std::atomic<size_t> usedBytes_{0};
+    std::atomic<size_t> evictions_{0};
+
+    // Only taken to register/unregister a channel and while evicting.
+    std::mutex mutex_;
+    std::vector<ChannelHistory*> histories_;
+};
+
+#endif //CHANNELHISTORY_H
\ No newline at end of file
@@ -4,17 +4,25 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <shared_mutex>
 #include <mutex>
+#include <atomic>
+#include <array>
 #include <vector>
-#include <optional>
-#include <functional>
 
 #include "Channel.h"
 #include "Client.h"
+#include "ChannelHistory.h"
 
+// Channel registry split into independently locked shards. Lookups take a shard's
+// shared lock just long enough to copy the channel's shared_ptr, so fan-out, joins and
+// /list never hold a registry lock while touching members. Every channel also gets a
+// dense ChannelId (below Client::MAX_CHANNEL_IDS), and resolving an id is a single
+// array load.
 class ChannelManager {
 public:
-    explicit ChannelManager(int maxChannels = 1000);
+    // historyBudget must outlive the manager; nullptr disables channel history.
+    explicit ChannelManager(int maxChannels = 1000, HistoryBudget* historyBudget = nullptr);
     ~ChannelManager() = default;
 
     ChannelManager(const ChannelManager&) = delete;
@@ -24,19 +32,25 @@ public:
     bool removeChannel(const std::string& channelName);
     bool channelExists(const std::string& channelName) const;
 
-    std::optional<std::reference_wrapper<Channel>> getChannel(const std::string& channelName);
-
-    std::optional<std::reference_wrapper<const Channel>> getChannel(const std::string& channelName) const;
+    std::shared_ptr<Channel> getChannel(const std::string& channelName) const;
+    std::shared_ptr<Channel> getChannel(ChannelId channelId) const;
 
     bool joinChannel(std::shared_ptr<Client> client, const std::string& channelName);
     bool leaveChannel(std::shared_ptr<Client> client, const std::string& channelName);
+    // For callers that already resolved the channel; skips the registry lookup.
+    bool leaveChannel(const std::shared_ptr<Client>& client, Channel& channel);
     void removeClientFromAllChannels(std::shared_ptr<Client> client);
+    // Creates the channel if needed and joins all `members` with one member-list publish.
+    bool restoreChannel(const std::string& channelName, const std::vector<std::shared_ptr<Client>>& members);
 
     void broadcastToChannel(const std::string& channelName, const std::string& message);
+    void broadcastToChannel(const std::string& channelName, const PayloadRef& message);
     void broadcastToAllChannels(const std::string& message);
 
 
     std::vector<std::string> getChannelList() const;
+    // Copies the channel pointers under each shard's shared lock in turn.
+    std::vector<std::shared_ptr<Channel>> snapshotChannels() const;
 
     std::vector<std::string> getClientChannels(std::shared_ptr<Client> client) const;
 
@@ -45,14 +59,32 @@ public:
     int getMaxChannels() const;
 
 private:
-    bool isValidChannelName(const std::string& channelName) const;
-    bool canCreateNewChannel_UNLOCKED() const;
-    bool createChannel_UNLOCKED(const std::string& channelName);
+    static constexpr size_t SHARD_COUNT = 32;
 
-    std::unordered_map<std::string, std::unique_ptr<Channel>> channels_;
-    mutable std::mutex channels_mutex_;
+    struct alignas(64) Shard {
+        std::unordered_map<std::string, std::shared_ptr<Channel>> channels;
+        mutable std::shared_mutex mutex;
+    };
+
+    bool isValidChannelName(const std::string& channelName) const;
+    bool reserveChannelSlot();
+    std::shared_ptr<Channel> createChannel_UNLOCKED(Shard& shard, const std::string& channelName);
+    ChannelId acquireChannelId();
+    void releaseChannelId(ChannelId channelId);
+    Shard& shardFor(const std::string& channelName);
+    const Shard& shardFor(const std::string& channelName) const;
+
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<int> channelCount_{0};
+
+    // Indexed by ChannelId. Ids are handed out below maxChannels and reused only after
+    // removeChannel has dropped them from every member.
+    std::unique_ptr<std::atomic<std::shared_ptr<Channel>>[]> channelsById_;
+    std::vector<ChannelId> freeChannelIds_;
+    std::mutex channelIdsMutex_;
 
     const int maxChannels_;
+    HistoryBudget* const historyBudget_;
 };
 
 #endif //CHANNELMANAGER_H
\ No newline at end of file
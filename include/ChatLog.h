@@ -0,0 +1,86 @@
+#ifndef CHATLOG_H
+#define CHATLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+
+#include "ChatLogFormat.h"
+#include "MpscQueue.h"
+
+// Append-only transcript of channel and private messages. Producers encode a record
+// into a pooled node and push it onto a lock-free queue; a single writer thread drains
+// the queue, appends whole batches to the current segment with one writev, and fsyncs
+// at most once per sync interval (group commit). Segments rotate once they would grow
+// past the configured size. See ChatLogFormat.h for the file layout.
+class ChatLog {
+public:
+    // A zero sync interval fsyncs after every batch. Throws std::system_error if the
+    // directory or the first segment cannot be created.
+    ChatLog(std::string directory, size_t segmentSize, std::chrono::milliseconds syncInterval);
+    // Writes out whatever is still queued and syncs. No producer may still be appending.
+    ~ChatLog();
+
+    ChatLog(const ChatLog&) = delete;
+    ChatLog& operator=(const ChatLog&) = delete;
+
+    void start();
+
+    void appendChannelMessage(std::string_view sender, std::string_view channel, std::string_view text);
+    void appendPrivateMessage(std::string_view sender, std::string_view recipient, std::string_view text);
+
+    const std::string& getDirectory() const;
+    size_t getWrittenRecords() const;
+    size_t getWrittenBytes() const;
+    size_t getFailedRecords() const;
+    size_t getSyncCount() const;
+
+private:
+    struct Record {
+        std::atomic<Record*> next{nullptr};
+        uint32_t size = 0;
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+        static Record* create(uint32_t size);
+        static void destroy(Record* record);
+    };
+
+    void append(ChatLogFormat::RecordType type, std::string_view sender, std::string_view target, std::string_view text);
+    void wakeup();
+    void run();
+    void drainQueue(std::vector<Record*>& batch);
+    void writeBatch(const std::vector<Record*>& batch);
+    void writeFully(std::vector<iovec>& iov);
+    void openSegment(uint64_t sequence);
+    void rotateSegment();
+    void syncSegment();
+
+    const std::string directory_;
+    const size_t segmentSize_;
+    const std::chrono::milliseconds syncInterval_;
+
+    MpscQueue<Record> queue_;
+    std::atomic<bool> signalled_{false};
+    std::atomic<bool> stopping_{false};
+    int wakeFd_ = -1;
+    std::thread thread_;
+
+    // Owned by the writer thread.
+    int segmentFd_ = -1;
+    uint64_t segmentSequence_ = 0;
+    size_t segmentBytes_ = 0;
+    bool unsynced_ = false;
+
+    std::atomic<size_t> writtenRecords_{0};
+    std::atomic<size_t> writtenBytes_{0};
+    std::atomic<size_t> failedRecords_{0};
+    std::atomic<size_t> syncCount_{0};
+};
+
+#endif //CHATLOG_H
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef CHATLOGFORMAT_H
+#define CHATLOGFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// On-disk layout of the chat log, shared by the writer, the reader and the tools.
+//
+// A log directory holds numbered segments, "chat-00000001.log", "chat-00000002.log", ...
+// Each segment starts with a SegmentHeader followed by back-to-back records:
+//
+//   RecordHeader | sender | target | text
+//
+// `length` counts everything after the length field itself, and `checksum` is FNV-1a
+// over everything after the checksum field, so a torn tail left by a crash is detected
+// and ignored. Integers are stored in host byte order.
+namespace ChatLogFormat {
+    constexpr char SEGMENT_MAGIC[8] = {'B', 'C', 'H', 'A', 'T', 'L', 'O', 'G'};
+    constexpr uint32_t SEGMENT_VERSION = 1;
+    constexpr const char* SEGMENT_PREFIX = "chat-";
+    constexpr const char* SEGMENT_SUFFIX = ".log";
+
+    enum class RecordType : uint8_t {
+        Channel = 1,
+        Private = 2
+    };
+
+    struct SegmentHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+    };
+
+    struct RecordHeader {
+        uint32_t length;
+        uint32_t checksum;
+        uint64_t timestampMicros; // Unix time
+        RecordType type;
+        uint8_t reserved;
+        uint16_t senderLength;
+        uint16_t targetLength;
+        uint16_t textLength;
+    };
+
+    static_assert(sizeof(SegmentHeader) == 16);
+    static_assert(sizeof(RecordHeader) == 24);
+
+    constexpr size_t LENGTH_FIELD_SIZE = sizeof(uint32_t);
+    constexpr size_t CHECKSUMMED_OFFSET = 2 * sizeof(uint32_t);
+    constexpr size_t MAX_FIELD_LENGTH = UINT16_MAX;
+
+    inline uint32_t checksum(const char* data, size_t length) {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    inline size_t recordSize(size_t senderLength, size_t targetLength, size_t textLength) {
+        return sizeof(RecordHeader) + senderLength + targetLength + textLength;
+    }
+}
+
+#endif //CHATLOGFORMAT_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#ifndef CHATLOGINDEX_H
+#define CHATLOGINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ChatLogSegment.h"
+
+// In-memory index over the segments of a chat log directory, extended incrementally by
+// refresh(). Per segment it keeps:
+//  - for every channel, a sparse list of (timestamp, offset) checkpoints taken at every
+//    CHECKPOINT_INTERVAL-th message of that channel, so a /history query seeks close to
+//    its first record and scans at most one interval of the channel from there;
+//  - optionally, an inverted index from word hash to the offsets of the records whose
+//    text contains the word, stored as varint deltas.
+// Queries map only the segments they touch, one at a time, and hold at most `limit`
+// offsets. Not thread-safe: refresh and queries must run on one thread.
+class ChatLogIndex {
+public:
+    static constexpr size_t CHECKPOINT_INTERVAL = 32;
+    static constexpr size_t MIN_TOKEN_LENGTH = 2;
+    static constexpr size_t MAX_TOKEN_LENGTH = 32;
+
+    using EntryHandler = std::function<void(const ChatLogEntry&)>;
+
+    ChatLogIndex(std::string directory, bool tokenIndex);
+
+    // Indexes the records appended since the previous call, picks up new segments and
+    // forgets deleted ones.
+    void refresh();
+
+    // The newest `limit` messages sent to `channel` at or after `sinceMicros`, passed to
+    // `onEntry` oldest first. Returns how many were found.
+    size_t findChannelMessages(std::string_view channel, uint64_t sinceMicros, size_t limit, const EntryHandler& onEntry) const;
+    // The newest `limit` records whose text contains every word of `query` (case-insensitive),
+    // optionally only those sent to `channel`, oldest first.
+    size_t grep(std::string_view query, std::string_view channel, size_t limit, const EntryHandler& onEntry) const;
+
+    size_t getIndexedRecords() const;
+    size_t getSegmentCount() const;
+    // Approximate heap bytes held by the checkpoints and postings.
+    size_t getMemoryUsage() const;
+
+    // Lowercased words of `text` (ASCII letters and digits plus any non-ASCII byte),
+    // shorter ones skipped and longer ones truncated.
+    static std::vector<std::string> tokenize(std::string_view text);
+
+private:
+    struct Checkpoint {
+        uint64_t timestampMicros;
+        uint64_t offset;
+    };
+
+    struct ChannelIndex {
+        std::vector<Checkpoint> checkpoints;
+        uint64_t count = 0;
+    };
+
+    struct Postings {
+        std::vector<uint8_t> deltas;
+        uint64_t lastOffset = 0;
+    };
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    struct SegmentIndex {
+        uint64_t sequence = 0;
+        std::string path;
+        uint64_t indexedEnd = sizeof(ChatLogFormat::SegmentHeader);
+        uint64_t lastTimestampMicros = 0;
+        uint64_t records = 0;
+        size_t memoryUsage = 0;
+        // Set once a newer segment exists and this one has been indexed to its end.
+        bool sealed = false;
+        std::unordered_map<std::string, ChannelIndex, NameHash, std::equal_to<>> channels;
+        std::unordered_map<uint32_t, Postings> tokens;
+    };
+
+    // A query's matches in one segment, ascending. The mapping is kept for delivery.
+    struct SegmentHits {
+        std::unique_ptr<ChatLogSegment> segment;
+        std::vector<uint64_t> offsets;
+    };
+
+    void indexSegment(SegmentIndex& index);
+    void indexTokens(SegmentIndex& index, const ChatLogEntry& entry);
+    std::vector<uint64_t> tokenCandidates(const SegmentIndex& index, const std::vector<uint32_t>& hashes) const;
+    static size_t deliver(std::vector<SegmentHits>& hits, const EntryHandler& onEntry);
+    static uint32_t hashToken(std::string_view token);
+
+    const std::string directory_;
+    const bool tokenIndex_;
+    std::vector<SegmentIndex> segments_; // ascending by sequence
+    size_t indexedRecords_ = 0;
+    size_t memoryUsage_ = 0;
+};
+
+#endif //CHATLOGINDEX_H
\ No newline at end of file
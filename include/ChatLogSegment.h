@@ -0,0 +1,66 @@
+#ifndef CHATLOGSEGMENT_H
+#define CHATLOGSEGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ChatLogFormat.h"
+
+// One decoded record. The views point into the segment's mapping.
+struct ChatLogEntry {
+    uint64_t offset = 0;
+    uint32_t size = 0;
+    uint64_t timestampMicros = 0;
+    ChatLogFormat::RecordType type = ChatLogFormat::RecordType::Channel;
+    std::string_view sender;
+    std::string_view target;
+    std::string_view text;
+};
+
+// Read-only mmap of one log segment. Only the bytes present when it was opened are
+// visible; records appended later need a fresh ChatLogSegment.
+class ChatLogSegment {
+public:
+    // Throws std::system_error if the file cannot be mapped or is not a chat log segment.
+    explicit ChatLogSegment(const std::string& path);
+    ~ChatLogSegment();
+
+    ChatLogSegment(const ChatLogSegment&) = delete;
+    ChatLogSegment& operator=(const ChatLogSegment&) = delete;
+
+    // Decodes the record at `offset`. Returns false past the last record and at a torn
+    // or corrupt one, which is how a crash mid-write shows up.
+    bool read(uint64_t offset, ChatLogEntry& entry) const;
+
+    // Calls `onEntry(const ChatLogEntry&)` for each record from `offset` on until it
+    // returns false or the records run out. Returns the offset where the scan stopped.
+    template <typename EntryHandler>
+    uint64_t forEach(EntryHandler&& onEntry, uint64_t offset = sizeof(ChatLogFormat::SegmentHeader)) const {
+        ChatLogEntry entry;
+        while (read(offset, entry)) {
+            if (!onEntry(entry)) {
+                return offset;
+            }
+            offset += entry.size;
+        }
+        return offset;
+    }
+
+    const std::string& getPath() const;
+    size_t getSize() const;
+
+    static std::string pathFor(const std::string& directory, uint64_t sequence);
+    // (sequence, path) of every segment in `directory`, oldest first.
+    static std::vector<std::pair<uint64_t, std::string>> list(const std::string& directory);
+
+private:
+    std::string path_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif //CHATLOGSEGMENT_H
\ No newline at end of file
@@ -2,44 +2,143 @@
 #define CLIENT_H
 
 #include <string>
-#include <unordered_set>
 #include <vector>
-#include <queue>
-#include <mutex>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <cstdint>
+#include <sys/uio.h>
+#include <memory>
+#include <chrono>
 
-class Client {
+#include "MessagePayload.h"
+#include "LineBuffer.h"
+#include "OutputPolicy.h"
+#include "ShardStats.h"
+#include "BlockPool.h"
+
+class Reactor;
+
+// Generational handle into ClientManager's slot table; it goes stale as soon as the
+// client is removed, even if the slot is reused.
+struct ClientId {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const ClientId&) const = default;
+};
+
+// Dense id ChannelManager assigns to a registered channel. Clients track membership by
+// id, so the per-message checks never hash or compare channel names.
+using ChannelId = uint32_t;
+constexpr ChannelId INVALID_CHANNEL_ID = UINT32_MAX;
+
+// Broadcast output (channel traffic, server-wide notices) may be shed under
+// backpressure; direct output (private messages, replies) is only dropped by DropOldest.
+enum class MessageKind : uint8_t {
+    Direct,
+    Broadcast
+};
+
+class Client : public std::enable_shared_from_this<Client> {
 public:
+    static constexpr size_t MAX_CHANNEL_IDS = 1024;
+
     explicit Client(int socket);
+    // Allocates the client and its shared_ptr control block from the BlockPool.
+    static std::shared_ptr<Client> create(int socket);
 
     Client(const Client&) = delete;
     Client& operator=(const Client&) = delete;
 
     int getSocket() const;
+    ClientId getId() const;
+    void setId(ClientId id);
     const std::string& getNickname() const;
-    const std::unordered_set<std::string>& getJoinedChannels() const;
-    std::string& getReadBuffer();
-    const std::string& getActiveChannel() const;
+    // Membership is a bitset of channel ids, so any thread can query or update it
+    // without a lock or an allocation.
+    bool isInChannel(ChannelId channel) const;
+    std::vector<ChannelId> getJoinedChannels() const;
+    LineBuffer& getInputBuffer();
+    ChannelId getActiveChannel() const;
 
     void setNickname(const std::string& name);
-    void setActiveChannel(const std::string& channelName);
-    void joinChannel(const std::string& channelName);
-    void leaveChannel(const std::string& channelName);
+    void setActiveChannel(ChannelId channel);
+    void joinChannel(ChannelId channel);
+    void leaveChannel(ChannelId channel);
 
-    void appendToBuffer(const char* data, size_t length);
+    // The output queue belongs to the owning reactor's thread; pushes from any other
+    // thread are forwarded through that reactor's mailbox instead of taking a lock.
+    void pushMessageToQueue(PayloadRef message, MessageKind kind = MessageKind::Direct);
+    // Queues a run of messages with a single accounting, backpressure and flush step.
+    void pushMessagesToQueue(const PayloadRef* messages, size_t count, MessageKind kind = MessageKind::Direct);
+    size_t getQueuedMessageCount() const;
+    // Safe to call from any thread, though only the owning reactor sees a settled value.
+    size_t getQueuedBytes() const;
+    bool hasPendingOutput() const;
 
-    void pushMessageToQueue(const std::string& message);
-    std::string getNextMessageFromQueue();
-    void popMessageFromQueue();
+    // Fills `iov` with the unsent bytes of up to `maxEntries` queued messages, starting
+    // inside the head message if it was only partially written. Returns the entry count.
+    size_t gatherOutput(iovec* iov, size_t maxEntries, size_t* totalBytes = nullptr) const;
+    // Drops messages that were written completely and remembers the offset into the next.
+    void consumeOutput(size_t bytes);
+    // Empties the queue and returns its unsent bytes. Only while no reactor owns the client.
+    std::string takePendingOutput();
+
+    bool isWriteBlocked() const;
+    void setWriteBlocked(bool blocked);
+
+    Reactor* getReactor() const;
+    uint64_t getConnectionId() const;
+    void setReactor(Reactor* reactor, uint64_t connectionId);
+    void clearFlushScheduled();
+    void setOutputPolicy(OutputPolicy* policy);
+    // Loop thread only, polled by the reactor while the client is congested under the
+    // disconnect policy. Returns false once there is nothing left to watch.
+    bool checkCongestionDeadline(std::chrono::steady_clock::time_point now);
+    // Set by the owning reactor while the client is registered with it.
+    void setShardStats(ShardStats* stats);
 
 private:
+    struct QueuedMessage {
+        PayloadRef payload;
+        MessageKind kind;
+    };
+
+    void handleCongestion();
+    void dropOldestOutput();
+    void dropBroadcastOutput();
+    void recordDrop(size_t bytes);
+    void adjustQueuedBytes(int64_t delta);
+
     const int socket_;
+    ClientId id_;
     std::string nickname_;
-    std::string readBuffer_;
-    std::unordered_set<std::string> joined_channels_;
-    std::string active_channel_;
+    LineBuffer inputBuffer_;
+    static constexpr size_t CHANNEL_WORD_BITS = 64;
+
+    std::array<std::atomic<uint64_t>, MAX_CHANNEL_IDS / CHANNEL_WORD_BITS> joined_channels_{};
+    std::atomic<ChannelId> active_channel_{INVALID_CHANNEL_ID};
+
+    using OutputQueue = std::deque<QueuedMessage, PoolAllocator<QueuedMessage>>;
+
+    OutputQueue output_queue_;
+    size_t outputOffset_ = 0;
+    // Written only by the owning reactor; other threads may read it for pacing.
+    std::atomic<size_t> queuedBytes_{0};
+    // Bytes of MessageKind::Broadcast entries in the queue, i.e. what drop_nonprivate may free.
+    size_t broadcastBytes_ = 0;
+    bool writeBlocked_ = false;
+
+    OutputPolicy* outputPolicy_ = nullptr;
+    ShardStats* shardStats_ = nullptr;
+    bool congested_ = false;
+    bool disconnectRequested_ = false;
+    std::chrono::steady_clock::time_point congestedSince_;
 
-    std::queue<std::string> output_queue_;
-    mutable std::mutex output_mutex_;
+    Reactor* reactor_ = nullptr;
+    uint64_t connectionId_ = 0;
+    bool flushScheduled_ = false;
 };
 
 #endif //CLIENT_H
\ No newline at end of file
@@ -2,30 +2,44 @@
 #define CLIENTMANAGER_H
 
 #include <memory>
-#include <unordered_set>
 #include <unordered_map>
 #include <vector>
 #include <mutex>
+#include <shared_mutex>
 #include <functional>
 #include <atomic>
+#include <array>
+#include <string_view>
 #include "Client.h"
 
+// Clients live in a fixed slot table indexed by ClientId. Liveness checks only compare a
+// slot's generation, so the per-line clientExists() on the input path takes no lock;
+// the mutex is left to add/remove and whole-table scans. Nicknames are indexed in a
+// separately sharded map.
 class ClientManager {
 public:
     explicit ClientManager(int maxClients);
 
     bool addClient(std::shared_ptr<Client> client);
     bool removeClient(std::shared_ptr<Client> client);
-    bool clientExists(std::shared_ptr<Client> client) const;
-    bool clientExistsByNickname(const std::string& nickname) const;
+    // Adds clients in order until the table is full, taking each lock once. Returns how
+    // many were added.
+    size_t restoreClients(const std::vector<std::shared_ptr<Client>>& clients);
+    // Shutdown path: closes every socket under a single lock, without the removal
+    // callback or any channel teardown. Returns how many clients were closed.
+    size_t closeAllClients();
+    bool clientExists(ClientId id) const;
+    std::shared_ptr<Client> getClient(ClientId id) const;
+    bool clientExistsByNickname(std::string_view nickname) const;
     bool updateClientNickname(std::shared_ptr<Client> client, const std::string& newNickname);
     bool isValidNickname(const std::string& nickname) const;
 
-    std::shared_ptr<Client> getClientByNickname(const std::string& nickname);
+    std::shared_ptr<Client> getClientByNickname(std::string_view nickname);
     std::vector<std::shared_ptr<Client>> getAllClients() const;
 
     void broadcastMessage(const std::string& message, std::shared_ptr<Client> sender = nullptr);
     void sendMessageToClient(std::shared_ptr<Client> client, const std::string& message);
+    void sendMessageToClient(const std::shared_ptr<Client>& client, PayloadRef message);
 
     size_t getClientCount() const;
     size_t getTotalConnectionsCount() const;
@@ -37,15 +51,40 @@ public:
     void setOnClientRemovedCallback(std::function<void(std::shared_ptr<Client>)> callback);
 
 private:
+    static constexpr size_t NICKNAME_SHARD_COUNT = 16;
+
+    struct Slot {
+        // Odd while the slot holds a live client; bumped on every add and remove.
+        std::atomic<uint32_t> generation{0};
+        std::shared_ptr<Client> client;
+    };
+
+    struct NicknameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view nickname) const { return std::hash<std::string_view>{}(nickname); }
+    };
+
+    struct alignas(64) NicknameShard {
+        std::unordered_map<std::string, std::shared_ptr<Client>, NicknameHash, std::equal_to<>> clients;
+        mutable std::shared_mutex mutex;
+    };
+
+    NicknameShard& nicknameShardFor(std::string_view nickname);
+    const NicknameShard& nicknameShardFor(std::string_view nickname) const;
+    void eraseNickname(const std::string& nickname, const std::shared_ptr<Client>& client);
+
     int maxClients_;
-    std::unordered_set<std::shared_ptr<Client>> clients_;
-    std::unordered_map<std::string, std::shared_ptr<Client>> nicknameToClient_;
+    std::unique_ptr<Slot[]> slots_;
+    std::vector<uint32_t> freeSlots_;
+    std::atomic<size_t> clientCount_{0};
+    std::array<NicknameShard, NICKNAME_SHARD_COUNT> nicknames_;
 
     std::atomic<size_t> totalConnections_{0};
 
     std::function<void(std::shared_ptr<Client>)> onClientAddedCallback_;
     std::function<void(std::shared_ptr<Client>)> onClientRemovedCallback_;
 
+    // Guards slots_[i].client and freeSlots_.
     mutable std::mutex clients_mutex_;
 };
 
@@ -0,0 +1,35 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+// Tokenized "/command arg arg ..." line. The command name, the arguments and any trailing
+// text are views into the original line, so parsing never allocates; the line must
+// outlive the CommandLine.
+class CommandLine {
+public:
+    static constexpr size_t MAX_ARGS = 16;
+
+    explicit CommandLine(std::string_view line);
+
+    std::string_view getName() const;
+    size_t getArgCount() const;
+    bool hasArgs() const;
+    std::string_view getArg(size_t index) const;
+    // Everything from argument `index` to the end of the line, inner whitespace untouched.
+    std::string_view getTrailing(size_t index) const;
+
+private:
+    static bool isSpace(char c);
+    static size_t skipSpaces(std::string_view text, size_t position);
+
+    std::string_view line_;
+    std::string_view name_;
+    std::array<std::string_view, MAX_ARGS> args_{};
+    size_t argCount_ = 0;
+    size_t argsStart_ = 0;
+};
+
+#endif //COMMANDLINE_H
\ No newline at end of file
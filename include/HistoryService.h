@@ -0,0 +1,84 @@
+#ifndef HISTORYSERVICE_H
+#define HISTORYSERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ChatLogIndex.h"
+#include "Client.h"
+#include "MessagePayload.h"
+
+// Owns the chat log index on a thread of its own: it refreshes the index periodically
+// and runs /history and grep queries in between, so neither touches a reactor or the
+// worker pool. Replies are cut into multi-line batches, and the next batch is only
+// handed to a client while less than STREAM_PAUSE_BYTES of the stream are still in
+// flight (in its reactor's mailbox or its output queue) and its queue is below that too.
+class HistoryService {
+public:
+    static constexpr size_t MAX_HISTORY_LIMIT = 500;
+    static constexpr size_t MAX_GREP_LIMIT = 1000;
+
+    HistoryService(std::string directory, bool tokenIndex, std::chrono::milliseconds refreshInterval);
+    ~HistoryService();
+
+    HistoryService(const HistoryService&) = delete;
+    HistoryService& operator=(const HistoryService&) = delete;
+
+    void start();
+
+    // Streams the newest `limit` messages of `channel` since `sinceMicros` to `client`.
+    void requestChannelHistory(std::shared_ptr<Client> client, std::string channel, uint64_t sinceMicros, size_t limit);
+    // Blocks until the query has run; one match per line.
+    std::string grep(std::string query, std::string channel, size_t limit);
+
+    size_t getIndexedRecords() const;
+    size_t getIndexMemoryUsage() const;
+
+private:
+    static constexpr size_t STREAM_BATCH_LINES = 50;
+    static constexpr size_t STREAM_PAUSE_BYTES = 64 * 1024;
+    static constexpr std::chrono::milliseconds STREAM_POLL_INTERVAL{5};
+    static constexpr std::chrono::seconds STREAM_TIMEOUT{30};
+
+    struct Stream {
+        std::shared_ptr<Client> client;
+        std::vector<PayloadRef> batches;
+        size_t next = 0;
+        // Batches before `released` have left the client's queue; the rest up to `next`
+        // are in flight and add up to `inFlightBytes`.
+        size_t released = 0;
+        size_t inFlightBytes = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void run();
+    void submit(std::function<void()> job);
+    void pumpStreams();
+    void publishCounters();
+    static std::string formatEntry(const ChatLogEntry& entry);
+
+    ChatLogIndex index_;
+    const std::chrono::milliseconds refreshInterval_;
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::vector<std::function<void()>> jobs_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    // Owned by the service thread.
+    std::vector<Stream> streams_;
+
+    std::atomic<size_t> indexedRecords_{0};
+    std::atomic<size_t> indexMemoryUsage_{0};
+};
+
+#endif //HISTORYSERVICE_H
\ No newline at end of file
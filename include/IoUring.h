@@ -0,0 +1,71 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <initializer_list>
+#include <linux/io_uring.h>
+
+// Minimal io_uring wrapper on top of the raw syscalls, so the server does not
+// depend on liburing. One instance per reactor thread; not thread-safe.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Returns a zeroed SQE, submitting queued entries first if the ring is full.
+    io_uring_sqe* getSqe();
+    int submitAndWait(unsigned waitCount);
+
+    // IORING_REGISTER_PROBE: true if the kernel supports every one of `opcodes`.
+    bool supportsOpcodes(std::initializer_list<uint8_t> opcodes) const;
+
+    io_uring_cqe* peekCqe();
+    void advanceCq(unsigned count);
+
+    // Provided buffer ring used by multishot recv (IOSQE_BUFFER_SELECT).
+    void registerBufferRing(uint16_t groupId, unsigned entries, size_t bufferSize);
+    char* getBuffer(uint16_t bufferId) const;
+    void recycleBuffer(uint16_t bufferId);
+    size_t getBufferSize() const;
+
+private:
+    int ringFd_ = -1;
+
+    void* sqRingPtr_ = nullptr;
+    size_t sqRingSize_ = 0;
+    void* cqRingPtr_ = nullptr;
+    size_t cqRingSize_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqesSize_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned* sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned sqLocalTail_ = 0;
+    unsigned sqSubmitted_ = 0;
+
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned cqMask_ = 0;
+
+    // Viewed as a plain io_uring_buf array: the C++ expansion of io_uring_buf_ring's
+    // flexible array member is not layout-compatible with the kernel's. The ring tail
+    // overlays bufs[0].resv.
+    io_uring_buf* bufferRing_ = nullptr;
+    size_t bufferRingSize_ = 0;
+    char* buffers_ = nullptr;
+    size_t buffersSize_ = 0;
+    size_t bufferSize_ = 0;
+    unsigned bufferEntries_ = 0;
+    uint16_t bufferTail_ = 0;
+};
+
+#endif //IOURING_H
@@ -0,0 +1,73 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear (HDR-style) histogram of nanosecond latencies: every power of two is split
+// into 16 linear sub-buckets, so any recorded value is reported within ~6%. Meant to
+// have a single writer thread; readers may merge it concurrently.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 40; // ~18 minutes
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    void record(uint64_t nanoseconds) {
+        bump(buckets_[bucketIndex(nanoseconds)]);
+        bump(count_);
+        sum_.store(sum_.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+        if (nanoseconds > max_.load(std::memory_order_relaxed)) {
+            max_.store(nanoseconds, std::memory_order_relaxed);
+        }
+    }
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<size_t>(value);
+        }
+        const unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        if (exponent > MAX_EXPONENT) {
+            return BUCKET_COUNT - 1;
+        }
+        const unsigned shift = exponent - SUB_BUCKET_BITS;
+        const uint64_t mantissa = value >> shift;
+        return (shift + 1) * SUB_BUCKET_COUNT + static_cast<size_t>(mantissa - SUB_BUCKET_COUNT);
+    }
+
+    // Largest value that lands in `index`.
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        const unsigned shift = static_cast<unsigned>(index / SUB_BUCKET_COUNT) - 1;
+        const uint64_t mantissa = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    // Plain, non-atomic copy used to merge and query histograms.
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+
+        void add(const LatencyHistogram& histogram);
+        uint64_t percentile(double quantile) const;
+    };
+
+private:
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+#endif //LATENCYHISTOGRAM_H
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef LATENCYMETRICS_H
+#define LATENCYMETRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "LatencyHistogram.h"
+
+enum class LatencyStage {
+    RecvToParsed,
+    ParsedToEnqueued,
+    EnqueuedToWritten,
+    Count
+};
+
+struct LatencySummary {
+    std::string name;
+    uint64_t count;
+    double sumMicros;
+    double p50Micros;
+    double p90Micros;
+    double p99Micros;
+    double p999Micros;
+    double maxMicros;
+};
+
+// Process-wide latency recorder. Every recording thread lazily gets its own block of
+// histograms, so recording is a couple of uncontended relaxed stores; summarize()
+// merges all blocks on demand.
+class LatencyMetrics {
+public:
+    static constexpr size_t MAX_COMMANDS = 64;
+    static constexpr size_t UNTRACKED_COMMAND = MAX_COMMANDS;
+
+    static LatencyMetrics& global();
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void recordStage(LatencyStage stage, uint64_t nanoseconds);
+    void recordCommand(size_t commandSlot, uint64_t nanoseconds);
+    // Returns the slot for `name`, reusing an existing one; UNTRACKED_COMMAND once full.
+    size_t registerCommand(const std::string& name);
+
+    // When the line currently being handled on this thread finished parsing.
+    static void setLineParsedAt(uint64_t timestamp);
+    static uint64_t getLineParsedAt();
+    // Records the time since the current line was parsed; a no-op outside line handling.
+    void recordSinceLineParsed(LatencyStage stage);
+
+    std::vector<LatencySummary> summarize() const;
+
+private:
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(LatencyStage::Count);
+
+    struct ThreadBlock {
+        std::array<LatencyHistogram, STAGE_COUNT> stages;
+        std::array<std::atomic<LatencyHistogram*>, MAX_COMMANDS> commands{};
+
+        ~ThreadBlock();
+    };
+
+    LatencyMetrics() = default;
+    ThreadBlock& localBlock();
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks_;
+    std::vector<std::string> commandNames_;
+};
+
+#endif //LATENCYMETRICS_H
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef LINEBUFFER_H
+#define LINEBUFFER_H
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Splits an incoming byte stream into '\n'-terminated lines. Lines that arrive whole
+// inside one chunk are handed out as views straight into that chunk; only an
+// unterminated tail is copied, and the next chunk completes it in place.
+class LineBuffer {
+public:
+    enum class Status {
+        Ok,
+        LineTooLong,
+        Stopped
+    };
+
+    // Calls `onLine(std::string_view)` for every complete line, without its '\n'. The
+    // view is only valid during the call. Returning false from `onLine` stops the scan.
+    template <typename LineHandler>
+    Status feed(const char* data, size_t length, size_t maxLineLength, LineHandler&& onLine) {
+        const char* cursor = data;
+        const char* const end = data + length;
+
+        if (!partial_.empty()) {
+            const char* newline = findNewline(cursor, end);
+            const size_t taken = (newline ? newline : end) - cursor;
+            if (partial_.size() + taken > maxLineLength) {
+                return Status::LineTooLong;
+            }
+            partial_.append(cursor, taken);
+            if (!newline) {
+                return Status::Ok;
+            }
+            cursor = newline + 1;
+            const bool keepGoing = onLine(std::string_view(partial_));
+            partial_.clear();
+            if (!keepGoing) {
+                return Status::Stopped;
+            }
+        }
+
+        while (const char* newline = findNewline(cursor, end)) {
+            if (static_cast<size_t>(newline - cursor) > maxLineLength) {
+                return Status::LineTooLong;
+            }
+            if (!onLine(std::string_view(cursor, newline - cursor))) {
+                return Status::Stopped;
+            }
+            cursor = newline + 1;
+        }
+
+        if (static_cast<size_t>(end - cursor) > maxLineLength) {
+            return Status::LineTooLong;
+        }
+        partial_.assign(cursor, end - cursor);
+        return Status::Ok;
+    }
+
+    size_t getPendingBytes() const { return partial_.size(); }
+    // The unterminated tail, e.g. to carry it over to another process.
+    std::string_view getPending() const { return partial_; }
+    void restorePending(std::string_view pending) { partial_.assign(pending); }
+
+private:
+    // glibc's memchr is already vectorised (SSE2/AVX2/EVEX picked at load time).
+    static const char* findNewline(const char* begin, const char* end) {
+        return static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+    }
+
+    std::string partial_;
+};
+
+#endif //LINEBUFFER_H
\ No newline at end of file
@@ -2,18 +2,24 @@
 #define MESSAGEMANAGER_H
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <functional>
 #include <unordered_map>
-#include <atomic>
 #include <vector>
+#include <array>
 
 #include "Client.h"
+#include "CommandLine.h"
+#include "ShardedCounter.h"
 
 class ChannelManager;
+class Channel;
 class ClientManager;
+class ChatLog;
+class HistoryService;
 
-using CommandHandler = std::function<void(std::shared_ptr<Client>, const std::vector<std::string>&)>;
+using CommandHandler = std::function<void(std::shared_ptr<Client>, const CommandLine&)>;
 
 class MessageManager {
 public:
@@ -23,51 +29,70 @@ public:
     MessageManager(const MessageManager&) = delete;
     MessageManager& operator=(const MessageManager&) = delete;
 
-    void handleMessage(std::shared_ptr<Client> sender, const std::string& message);
-    void handleCommand(std::shared_ptr<Client> sender, const std::string& command);
+    void handleMessage(const std::shared_ptr<Client>& sender, std::string_view message);
+    void handleCommand(const std::shared_ptr<Client>& sender, std::string_view command);
 
     void broadcastMessage(std::shared_ptr<Client> sender, const std::string& message);
-    void sendPrivateMessage(std::shared_ptr<Client> sender, const std::string& recipient, const std::string& message);
-    void sendChannelMessage(std::shared_ptr<Client> sender, const std::string& channelName, const std::string& message);
+    void sendPrivateMessage(std::shared_ptr<Client> sender, std::string_view recipient, std::string_view message);
+    void sendChannelMessage(std::shared_ptr<Client> sender, const std::string& channelName, std::string_view message);
     void sendServerMessage(std::shared_ptr<Client> client, const std::string& message);
 
+    // Registered commands take precedence over a built-in of the same name.
     void registerCommand(const std::string& name, CommandHandler handler);
     void unregisterCommand(const std::string& name);
 
     size_t getProcessedMessagesCount() const;
     size_t getProcessedCommandsCount() const;
     size_t getSentMessagesCount() const;
-    size_t getReceivedBytesCount() const;
-    size_t getSentBytesCount() const;
 
     void setMotd(const std::string& motd);
     std::string getMotd() const;
+    // Channel and private messages are also appended here; nullptr turns logging off.
+    void setChatLog(ChatLog* chatLog);
+    // Serves /history; without one the command reports that history is unavailable.
+    void setHistoryService(HistoryService* historyService);
 
 private:
     ClientManager& clientManager_;
     ChannelManager& channelManager_;
     
-    std::unordered_map<std::string, CommandHandler> commandHandlers_;
+    struct CommandNameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+    };
+
+    static constexpr size_t BUILTIN_COMMAND_COUNT = 10;
+    static constexpr size_t DEFAULT_HISTORY_LIMIT = 50;
+
+    struct RegisteredCommand {
+        CommandHandler handler;
+        size_t latencySlot;
+    };
+
+    std::unordered_map<std::string, RegisteredCommand, CommandNameHash, std::equal_to<>> commandHandlers_;
+    std::array<bool, BUILTIN_COMMAND_COUNT> builtinDisabled_{};
+    std::array<size_t, BUILTIN_COMMAND_COUNT> builtinLatencySlots_{};
     std::string motd_;
-
-    std::atomic<size_t> processedMessages_{0};
-    std::atomic<size_t> processedCommands_{0};
-    std::atomic<size_t> sentMessages_{0};
-    std::atomic<size_t> receivedBytes_{0};
-    std::atomic<size_t> sentBytes_{0};
-
-    std::vector<std::string> parseCommandArgs(const std::string& commandLine);
-    void setupDefaultCommands();
-
-    void handleNickCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handleJoinCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handlePartCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handleQuitCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handleListCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handleWhoCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handlePrivmsgCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handleMotdCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
-    void handleHelpCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args);
+    ChatLog* chatLog_ = nullptr;
+    HistoryService* historyService_ = nullptr;
+
+    ShardedCounter processedMessages_;
+    ShardedCounter processedCommands_;
+    ShardedCounter sentMessages_;
+
+    void sendChannelMessage(const std::shared_ptr<Client>& sender, Channel& channel, std::string_view message);
+    bool dispatchBuiltin(const std::shared_ptr<Client>& client, int index, const CommandLine& command);
+
+    void handleNickCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleJoinCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handlePartCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleQuitCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleListCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleWhoCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handlePrivmsgCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleMotdCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleHelpCommand(std::shared_ptr<Client> client, const CommandLine& command);
+    void handleHistoryCommand(std::shared_ptr<Client> client, const CommandLine& command);
 };
 
 #endif //MESSAGEMANAGER_H
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef MESSAGEPAYLOAD_H
+#define MESSAGEPAYLOAD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <utility>
+
+class PayloadRef;
+
+// Immutable, intrusively refcounted wire-format line. The bytes live directly behind
+// the header in one allocation, so a broadcast formats a line once and every
+// recipient's output queue just holds another reference to it.
+class MessagePayload {
+public:
+    static PayloadRef create(std::string_view text);
+    static PayloadRef concat(std::initializer_list<std::string_view> parts);
+
+    MessagePayload(const MessagePayload&) = delete;
+    MessagePayload& operator=(const MessagePayload&) = delete;
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    size_t size() const { return size_; }
+    std::string_view view() const { return {data(), size_}; }
+    // Steady-clock nanoseconds at creation, i.e. when the line was handed to delivery.
+    uint64_t getCreatedAt() const { return createdAt_; }
+
+private:
+    friend class PayloadRef;
+
+    MessagePayload(uint32_t size, uint64_t createdAt) : size_(size), createdAt_(createdAt) {}
+
+    static MessagePayload* allocate(size_t size);
+    static void release(MessagePayload* payload);
+
+    char* mutableData() { return reinterpret_cast<char*>(this + 1); }
+
+    std::atomic<uint32_t> refCount_{1};
+    const uint32_t size_;
+    const uint64_t createdAt_;
+};
+
+// Owning handle to a MessagePayload; copying only bumps the refcount.
+class PayloadRef {
+public:
+    PayloadRef() = default;
+    PayloadRef(const PayloadRef& other) : payload_(other.payload_) {
+        if (payload_) payload_->refCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    PayloadRef(PayloadRef&& other) noexcept : payload_(std::exchange(other.payload_, nullptr)) {}
+    ~PayloadRef() { reset(); }
+
+    PayloadRef& operator=(PayloadRef other) noexcept {
+        std::swap(payload_, other.payload_);
+        return *this;
+    }
+
+    void reset() {
+        if (payload_ && payload_->refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            MessagePayload::release(payload_);
+        }
+        payload_ = nullptr;
+    }
+
+    // True when this is the only reference, e.g. once every queue holding it has let go.
+    bool isUnique() const { return payload_ && payload_->refCount_.load(std::memory_order_acquire) == 1; }
+
+    const MessagePayload* get() const { return payload_; }
+    const MessagePayload* operator->() const { return payload_; }
+    const MessagePayload& operator*() const { return *payload_; }
+    explicit operator bool() const { return payload_ != nullptr; }
+
+private:
+    friend class MessagePayload;
+
+    explicit PayloadRef(MessagePayload* payload) : payload_(payload) {}
+
+    MessagePayload* payload_ = nullptr;
+};
+
+#endif //MESSAGEPAYLOAD_H
@@ -0,0 +1,58 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <stdexcept>
+
+// Minimal HTTP listener for the admin side port. It serves whatever the scrape callback
+// renders (Prometheus text format) on its own thread, one request per connection, so a
+// scrape never runs on a reactor thread. Further plain-text GET endpoints can be added
+// with setRequestHandler.
+class MetricsServer {
+public:
+    using ScrapeCallback = std::function<std::string()>;
+    // Receives the raw query string (after '?') and returns a text/plain body.
+    using RequestHandler = std::function<std::string(std::string_view query)>;
+
+    // Thrown by a RequestHandler to answer 400 with the message as the body.
+    class BadRequest : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    MetricsServer(const std::string& address, int port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void setOnScrapeCallback(ScrapeCallback callback);
+    // Must be called before start().
+    void setRequestHandler(const std::string& path, RequestHandler handler);
+
+    // Decoded value of `name` in a query string ("a=1&b=x%20y"), or "" if absent.
+    static std::string getQueryParameter(std::string_view query, std::string_view name);
+
+    void start();
+    // Only writes to an eventfd, so any thread may call it; Server::stop() does so from
+    // the signal-handling thread in main.
+    void stop();
+
+private:
+    static constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+    int listeningSocket_ = -1;
+    int wakeFd_ = -1;
+    std::thread thread_;
+    ScrapeCallback onScrape_;
+    std::unordered_map<std::string, RequestHandler> handlers_;
+
+    void run();
+    void serveConnection(int socket);
+};
+
+#endif //METRICSSERVER_H
\ No newline at end of file
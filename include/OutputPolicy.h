@@ -0,0 +1,39 @@
+#ifndef OUTPUTPOLICY_H
+#define OUTPUTPOLICY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+enum class SlowConsumerPolicy {
+    DropOldest,
+    DropNonPrivate,
+    Disconnect
+};
+
+// Limits on a client's unsent output. Once the queue passes `highWatermark` bytes the
+// client is congested until it drains below `lowWatermark`; what happens meanwhile is
+// up to `policy`. One instance is shared by every client of a server, and the drop
+// counters aggregate over all of them.
+struct OutputPolicy {
+    size_t highWatermark = 1024 * 1024;
+    size_t lowWatermark = 256 * 1024;
+    SlowConsumerPolicy policy = SlowConsumerPolicy::DropOldest;
+    std::chrono::milliseconds disconnectAfter{10000};
+
+    std::atomic<uint64_t> droppedBytes{0};
+    std::atomic<uint64_t> droppedMessages{0};
+    std::atomic<uint64_t> slowConsumerDisconnects{0};
+};
+
+inline std::optional<SlowConsumerPolicy> parseSlowConsumerPolicy(const std::string& name) {
+    if (name == "drop_oldest") return SlowConsumerPolicy::DropOldest;
+    if (name == "drop_nonprivate") return SlowConsumerPolicy::DropNonPrivate;
+    if (name == "disconnect") return SlowConsumerPolicy::Disconnect;
+    return std::nullopt;
+}
+
+#endif //OUTPUTPOLICY_H
\ No newline at end of file
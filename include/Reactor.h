@@ -0,0 +1,201 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <functional>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <climits>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "Client.h"
+#include "MessagePayload.h"
+#include "MpscQueue.h"
+#include "IoUring.h"
+#include "BlockPool.h"
+
+enum class IoBackend {
+    Epoll,
+    IoUring
+};
+
+// One message addressed to a group of clients owned by the same reactor. The recipients
+// are raw pointers; `keepAlive` owns them (e.g. a channel's member snapshot) until the
+// owning reactor has queued the message.
+struct Delivery {
+    std::atomic<Delivery*> next{nullptr};
+    std::vector<Client*> recipients;
+    std::shared_ptr<const void> keepAlive;
+    PayloadRef message;
+    MessageKind kind = MessageKind::Direct;
+
+    static void* operator new(size_t size) { return BlockPool::allocate(size); }
+    static void operator delete(void* block, size_t size) { BlockPool::deallocate(block, size); }
+};
+
+// Event loop for one I/O shard, driven either by edge-triggered epoll or by io_uring
+// (multishot accept/recv into a provided buffer ring, vectored SENDMSG). Every client is
+// owned by exactly one reactor for its lifetime, and only that reactor's thread touches
+// the client's output queue; other threads hand messages over through the mailbox.
+class Reactor {
+public:
+    using ConnectionCallback = std::function<void(int clientSocket)>;
+    using InputCallback = std::function<void(const std::shared_ptr<Client>&, const char* data, size_t length)>;
+    using ClientCallback = std::function<void(const std::shared_ptr<Client>&)>;
+
+    static constexpr size_t RECV_BUFFER_SIZE = 4096;
+
+    explicit Reactor(size_t shardIndex = 0, IoBackend backend = IoBackend::Epoll);
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    void run();
+    void stop();
+
+    void addListener(int socket);
+    bool addClient(std::shared_ptr<Client> client);
+    void removeClient(std::shared_ptr<Client> client);
+    void scheduleFlush(std::shared_ptr<Client> client);
+    void post(std::vector<Client*> recipients, std::shared_ptr<const void> keepAlive, PayloadRef message, MessageKind kind);
+    // Loop thread only; the disconnect runs once the current batch of events is done.
+    void requestDisconnect(std::shared_ptr<Client> client);
+    // Loop thread only: polls client->checkCongestionDeadline() until it returns false.
+    void watchCongestion(std::shared_ptr<Client> client);
+    // After run() has returned: settles in-flight sends, delivers the mailbox and hands
+    // every client back unowned (no reactor, no flush pending), closing the io_uring ring
+    // so no multishot accept/recv consumes data meant for the next owner.
+    void detachClients();
+    // After run() has returned: queues `notice` to every client and keeps flushing until
+    // all output is written or `deadline` passes. Input is discarded.
+    void drain(const PayloadRef& notice, std::chrono::steady_clock::time_point deadline);
+
+    bool isInLoopThread() const;
+    bool isRegistered(const Client* client) const;
+    bool isRegistered(const std::shared_ptr<Client>& client) const { return isRegistered(client.get()); }
+    IoBackend getBackend() const;
+    size_t getShardIndex() const;
+    size_t getClientCount() const;
+    const ShardStats& getShardStats() const;
+
+    void setOnConnectionCallback(ConnectionCallback callback);
+    void setOnInputCallback(InputCallback callback);
+    void setOnDisconnectCallback(ClientCallback callback);
+    void setOnWritableCallback(ClientCallback callback);
+
+private:
+    static constexpr int MAX_EVENTS = 256;
+    static constexpr unsigned RING_ENTRIES = 4096;
+    static constexpr unsigned RECV_BUFFER_COUNT = 512;
+    static constexpr uint16_t RECV_BUFFER_GROUP = 0;
+    static constexpr size_t SEND_IOV_MAX = IOV_MAX;
+    static constexpr std::chrono::milliseconds ACCEPT_BACKOFF{100};
+    static constexpr std::chrono::milliseconds CONGESTION_CHECK_INTERVAL{100};
+
+    enum class UringOp : uint8_t {
+        Wakeup = 1,
+        Accept,
+        Recv,
+        Send,
+        Cancel,
+        Timeout,
+        AcceptBackoff,
+        CongestionCheck
+    };
+
+    struct Connection {
+        std::shared_ptr<Client> client;
+        // io_uring only: the in-flight SENDMSG references these until it completes.
+        bool sendInFlight = false;
+        msghdr sendMessage{};
+        std::vector<iovec> sendIov;
+    };
+
+    void runEpoll();
+    void acceptConnections(int listeningSocket);
+    void readClient(const std::shared_ptr<Client>& client);
+
+    void runIoUring();
+    void armWakeup();
+    void armAccept(int listeningSocket);
+    void armAcceptBackoff(int listeningSocket);
+    void armRecv(uint64_t connectionId, int socket);
+    void rearmStarvedRecvs();
+    void armCongestionCheck();
+    void handleCompletion(const io_uring_cqe& cqe);
+    void handleSendCompletion(uint64_t connectionId, int result);
+    void flushIoUring(uint64_t connectionId, Connection& connection);
+    void settleIoUring();
+    void drainEpoll(std::chrono::steady_clock::time_point deadline);
+    void drainIoUring(std::chrono::steady_clock::time_point deadline);
+    void processDisconnects();
+
+    void wakeup();
+    void drainWakeupFd();
+    void processPending();
+    void checkCongestion();
+    void drainMailbox();
+    void flushClient(const std::shared_ptr<Client>& client);
+    void removeClient_UNLOCKED(const std::shared_ptr<Client>& client);
+
+    const size_t shardIndex_;
+    const IoBackend backend_;
+    int epollFd_ = -1;
+    int wakeupFd_ = -1;
+    std::unique_ptr<IoUring> ring_;
+    // io_uring only: recvs that hit -ENOBUFS, re-armed once the batch returned its buffers.
+    std::vector<uint64_t> starvedRecvs_;
+    const __kernel_timespec acceptBackoff_{0, std::chrono::nanoseconds(ACCEPT_BACKOFF).count()};
+    const __kernel_timespec congestionCheckInterval_{0, std::chrono::nanoseconds(CONGESTION_CHECK_INTERVAL).count()};
+    bool congestionCheckArmed_ = false;
+    std::vector<std::shared_ptr<Client>> congestedClients_;
+    std::chrono::steady_clock::time_point nextCongestionCheck_;
+    std::atomic<bool> stopRequested_{false};
+    std::atomic<size_t> clientCount_{0};
+    ShardStats stats_;
+
+    std::vector<int> listeners_;
+    std::unordered_map<uint64_t, Connection> clients_;
+    std::unordered_map<uint64_t, Connection> retired_;
+    uint64_t nextConnectionId_ = 1;
+    std::vector<char> recvBuffer_;
+    std::vector<std::shared_ptr<Client>> localFlushes_;
+    std::vector<std::shared_ptr<Client>> localDisconnects_;
+
+    MpscQueue<Delivery> mailbox_;
+    std::atomic<bool> mailboxSignalled_{false};
+
+    std::vector<std::shared_ptr<Client>> pendingRemovals_;
+    std::mutex pending_mutex_;
+
+    ConnectionCallback onConnectionCallback_;
+    InputCallback onInputCallback_;
+    ClientCallback onDisconnectCallback_;
+    ClientCallback onWritableCallback_;
+};
+
+// Fans one message out to many clients: recipients owned by the calling reactor are
+// queued directly, the rest cost a single mailbox post per foreign shard. `keepAlive`
+// must own every client passed to add(), so no per-recipient refcounts are taken.
+class DeliveryBatch {
+public:
+    DeliveryBatch(PayloadRef message, std::shared_ptr<const void> keepAlive);
+
+    void add(Client* client);
+    void dispatch();
+
+private:
+    PayloadRef message_;
+    std::shared_ptr<const void> keepAlive_;
+    std::vector<std::pair<Reactor*, std::vector<Client*>>> remote_;
+};
+
+#endif //REACTOR_H
@@ -7,19 +7,54 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
 
 #include "ThreadPool.h"
+#include "Reactor.h"
 #include "ChannelManager.h"
 #include "ClientManager.h"
 #include "MessageManager.h"
-
+#include "OutputPolicy.h"
+#include "LatencyMetrics.h"
+#include "MetricsServer.h"
+#include "ChannelHistory.h"
+#include "ChatLog.h"
+#include "HistoryService.h"
+#include "WarmRestart.h"
+
+// Point-in-time view assembled from per-shard and per-thread counters. Byte counts are
+// what actually went through the sockets; rates cover the time since the previous
+// getStats() call. Latencies are cumulative since startup.
 struct ServerStats {
     size_t activeConnections;
     size_t totalConnections;
+    size_t closedConnections;
     size_t bytesReceived;
     size_t bytesSent;
+    size_t writeCalls;
+    size_t messagesReceived;
+    size_t commandsProcessed;
+    size_t messagesSent;
+    double messagesReceivedPerSecond;
+    double messagesSentPerSecond;
+    double bytesSentPerSecond;
+    size_t queuedOutputBytes;
     size_t activeThreads;
     size_t pendingTasks;
+    size_t droppedBytes;
+    size_t droppedMessages;
+    size_t slowConsumerDisconnects;
+    size_t historyBytes;
+    size_t historyEvictions;
+    size_t chatLogRecords;
+    size_t chatLogBytes;
+    size_t chatLogFailedRecords;
+    size_t chatLogSyncs;
+    size_t chatLogIndexedRecords;
+    size_t chatLogIndexBytes;
+    std::vector<LatencySummary> latencies;
 };
 
 class Server {
@@ -33,41 +68,102 @@ public:
 
     void start();
     void stop();
+    // Stops serving and hands every socket and the client/channel state to a freshly
+    // executed copy of this process; start() returns once it has taken over. If the
+    // handoff fails, this process resumes.
+    void requestWarmRestart();
 
     bool isRunning() const;
 
     int getPort() const;
     int getMaxUsers() const;
     int getMaxChannels() const;
+    int getIoThreads() const;
+    int getWorkerThreads() const;
+    std::string getIoBackend() const;
+    int getMetricsPort() const;
     std::string getServerName() const;
     std::string getMOTD() const;
 
     ServerStats getStats() const;
+    // Prometheus text exposition of the stats, channel sizes and latency summaries.
+    std::string renderMetrics() const;
 
 private:
-    static constexpr size_t MAX_CLIENT_BUFFER_SIZE = 8192; // 8 KB
+    static constexpr size_t MAX_CLIENT_BUFFER_SIZE = 8192; // 8 KB per line
 
     int port_;
     int maxUsers_;
     int maxChannels_;
     std::string servername_;
     std::string motd_;
+    int ioThreads_;
+    std::string ioBackend_;
+    int workerThreads_;
+    int metricsPort_ = 0;
+    std::string metricsAddress_;
+    int historyLines_;
+    size_t historyBudgetBytes_;
+    std::string chatLogDirectory_;
+    size_t chatLogSegmentSize_;
+    int chatLogSyncMs_;
+    bool chatLogTokenIndex_ = false;
+    std::chrono::milliseconds drainTimeout_;
     std::unordered_map<std::string, std::string> config_;
-    int listeningSocket_;
+    std::vector<int> listeningSockets_;
+    // Shared by every client, so it must outlive the managers and reactors below.
+    OutputPolicy outputPolicy_;
+    // Every channel's history is charged against this, so it is declared before them too.
+    std::unique_ptr<HistoryBudget> historyBudget_;
 
     std::unique_ptr<ChannelManager> channelManager_;
     std::unique_ptr<ClientManager> clientManager_;
     std::unique_ptr<MessageManager> messageManager_;
 
-    ThreadPool threadPool_;
+    std::unique_ptr<ThreadPool> threadPool_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    std::vector<std::thread> reactorThreads_;
+    std::unique_ptr<MetricsServer> metricsServer_;
+    std::unique_ptr<ChatLog> chatLog_;
+    std::unique_ptr<HistoryService> historyService_;
     std::atomic<bool> running_{false};
+    std::atomic<bool> warmRestartRequested_{false};
+    // Lets stop() run on the signal thread while start() replaces reactors or services.
+    std::mutex lifecycleMutex_;
+
+    struct StatsSample {
+        std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+        size_t messagesReceived = 0;
+        size_t messagesSent = 0;
+        size_t bytesSent = 0;
+    };
+    mutable StatsSample lastStatsSample_;
+    mutable std::mutex statsMutex_;
 
 
     void validateConfig();
-    void initializeSocket();
+    void readOutputPolicy();
+    int openListeningSocket();
+    void initializeSocket(const std::vector<int>& inheritedSockets);
     void initializeManagers();
-    void handleClient(std::shared_ptr<Client> client);
-    void processClientOutput(std::shared_ptr<Client> client);
+    void initializeReactors();
+    void initializeMetrics();
+    void initializeChatLog();
+    void runReactors();
+    void runReactor(Reactor& reactor);
+    void joinReactors();
+    void releaseServices();
+    bool handOff();
+    ServerState captureState(const std::vector<std::shared_ptr<Client>>& clients);
+    void restoreState(const ServerState& state);
+    void attachClient(const std::shared_ptr<Client>& client, const std::string& pendingOutput, size_t index);
+    void abandonSockets();
+    void acceptClient(Reactor& reactor, int clientSocket);
+    void disconnectClient(const std::shared_ptr<Client>& client);
+    void drainClients();
+    void disconnectAllClients();
+    void handleClient(const std::shared_ptr<Client>& client, const char* data, size_t length);
+    void processClientOutput(const std::shared_ptr<Client>& client);
     bool canAcceptNewConnection() const;
 };
 
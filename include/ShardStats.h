@@ -0,0 +1,24 @@
+#ifndef SHARDSTATS_H
+#define SHARDSTATS_H
+
+#include <atomic>
+#include <cstdint>
+
+// Counters owned by one reactor. Only the reactor's loop thread writes them, so
+// updates are plain load/store pairs instead of locked read-modify-writes, and the
+// structure sits on its own cache lines; other threads read with relaxed loads.
+struct alignas(64) ShardStats {
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> writeCalls{0};
+    std::atomic<uint64_t> connectionsAccepted{0};
+    std::atomic<uint64_t> connectionsClosed{0};
+    std::atomic<int64_t> queuedBytes{0};
+
+    template <typename T>
+    static void add(std::atomic<T>& counter, T amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+#endif //SHARDSTATS_H
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef SHARDEDCOUNTER_H
+#define SHARDEDCOUNTER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Monotonic counter split across cache-line-sized cells. Each thread increments the
+// cell picked for it on first use, so hot counters bumped from every reactor stop
+// bouncing one cache line between cores; reads sum all cells.
+class ShardedCounter {
+public:
+    void add(uint64_t amount = 1) {
+        cells_[cellIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    uint64_t load() const {
+        uint64_t total = 0;
+        for (const auto& cell : cells_) {
+            total += cell.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    static constexpr size_t CELL_COUNT = 64;
+
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static size_t cellIndex() {
+        static std::atomic<size_t> nextIndex{0};
+        thread_local const size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed) % CELL_COUNT;
+        return index;
+    }
+
+    std::array<Cell, CELL_COUNT> cells_;
+};
+
+#endif //SHARDEDCOUNTER_H
\ No newline at end of file
@@ -2,36 +2,70 @@
 #define THREADPOOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
+#include <array>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <functional>
 #include <atomic>
 
+#include "Task.h"
+#include "WorkStealingDeque.h"
+
+enum class TaskPriority {
+    High,
+    Normal
+};
+
+// Work-stealing pool. Each worker owns one Chase-Lev deque per priority lane; tasks
+// submitted from a worker go to its own deque, tasks from any other thread to a shared
+// injection queue. Idle workers steal, and every source is drained high lane first, so
+// control work (disconnect teardown) never waits behind bulk work.
+//
+// The server currently submits only channel teardown, on the high lane. Broadcasts, PING
+// and disconnect handling run on the reactor threads, since moving fan-out here would let
+// workers reorder a channel's messages; the normal lane has no caller yet.
 class ThreadPool {
 public:
     explicit ThreadPool(int threadCount);
     ~ThreadPool();
 
-    bool enqueue(std::function<void()> task);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    bool enqueue(Task task, TaskPriority priority = TaskPriority::Normal);
 
     size_t getTaskCount() const;
     size_t getActiveThreadCount() const;
+    size_t getThreadCount() const;
 
 private:
-    void workerLoop();
+    static constexpr size_t PRIORITY_COUNT = 2;
+
+    struct alignas(64) Worker {
+        std::array<WorkStealingDeque<Task*>, PRIORITY_COUNT> deques;
+        std::thread thread;
+    };
+
+    void workerLoop(size_t index);
+    Task* takeTask(size_t index);
+    Task* takeInjected(size_t lane);
+    void runTask(Task* task);
 
-    static constexpr size_t MAX_QUEUE_SIZE = 5000;
+    std::vector<std::unique_ptr<Worker>> workers_;
 
-    std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+    std::array<std::deque<Task*>, PRIORITY_COUNT> injected_;
+    std::array<std::atomic<size_t>, PRIORITY_COUNT> injectedCount_{};
+    std::mutex injectMutex_;
 
-    std::atomic<size_t> activeThreads_;
-    bool running_;
+    std::atomic<size_t> pendingTasks_{0};
+    std::atomic<size_t> sleepingThreads_{0};
+    std::atomic<size_t> activeThreads_{0};
+    std::atomic<bool> running_{true};
 
-    mutable std::mutex mutex_;
-    std::condition_variable condition_;
+    std::mutex sleepMutex_;
+    std::condition_variable wakeCondition_;
 };
 
 #endif //THREADPOOL_H
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef WARMRESTART_H
+#define WARMRESTART_H
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What a running server hands to its replacement. Socket numbers are the sender's; on
+// the receiving side they are the installed descriptors (normally the same numbers).
+struct ClientState {
+    int socket = -1;
+    std::string nickname;
+    std::vector<std::string> channels;
+    std::string activeChannel;
+    // Unsent output, starting inside the first message if it was partially written.
+    std::string pendingOutput;
+    // Received bytes of an unterminated line.
+    std::string pendingInput;
+};
+
+struct ServerState {
+    std::vector<int> listeningSockets;
+    std::vector<std::string> channels;
+    std::vector<ClientState> clients;
+};
+
+// Hot upgrade: the old process re-executes its own command line with a Unix socket in
+// the environment, writes a compact binary snapshot of ServerState over it and passes
+// every listening and client socket along with SCM_RIGHTS. It exits once the new
+// process confirms it is serving, so clients keep their connections.
+class WarmRestart {
+public:
+    static constexpr const char* HANDOFF_FD_ENV = "BOLTCHAT_HANDOFF_FD";
+    static constexpr std::chrono::seconds CONFIRM_TIMEOUT{10};
+
+    struct Handoff {
+        ServerState state;
+        int socket = -1;
+    };
+
+    // Old process. Returns true once the new process has confirmed; on any failure the
+    // new process is killed and the sockets remain solely ours.
+    static bool handOff(const ServerState& state);
+
+    // New process. Returns std::nullopt unless started by handOff(). The received
+    // sockets are moved back to their original numbers where those are free. Throws
+    // std::system_error on a broken handoff.
+    static std::optional<Handoff> receive();
+    // Tells the old process to exit.
+    static void confirm(Handoff& handoff);
+};
+
+#endif //WARMRESTART_H
\ No newline at end of file
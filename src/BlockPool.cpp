@@ -0,0 +1,158 @@
+#include "BlockPool.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // Steps of ~1.5x keep the waste on typical chat lines (40-300 bytes) low.
+    constexpr std::array<size_t, 14> SIZE_CLASSES = {
+        32, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+    };
+    constexpr size_t CLASS_COUNT = SIZE_CLASSES.size();
+    constexpr size_t GRANULE = 32;
+    constexpr size_t SLAB_SIZE = 64 * 1024;
+    constexpr size_t TRANSFER_BATCH = 32;
+    constexpr size_t LOCAL_CACHE_LIMIT = 2 * TRANSFER_BATCH;
+
+    static_assert(SIZE_CLASSES.back() == BlockPool::MAX_POOLED_SIZE);
+
+    constexpr std::array<uint8_t, BlockPool::MAX_POOLED_SIZE / GRANULE + 1> buildClassLookup() {
+        std::array<uint8_t, BlockPool::MAX_POOLED_SIZE / GRANULE + 1> lookup{};
+        size_t sizeClass = 0;
+        for (size_t granules = 0; granules < lookup.size(); ++granules) {
+            while (SIZE_CLASSES[sizeClass] < granules * GRANULE) ++sizeClass;
+            lookup[granules] = static_cast<uint8_t>(sizeClass);
+        }
+        return lookup;
+    }
+    constexpr auto CLASS_LOOKUP = buildClassLookup();
+
+    size_t classFor(size_t bytes) {
+        return CLASS_LOOKUP[(bytes + GRANULE - 1) / GRANULE];
+    }
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct FreeList {
+        FreeBlock* head = nullptr;
+        size_t count = 0;
+
+        void push(FreeBlock* block) {
+            block->next = head;
+            head = block;
+            ++count;
+        }
+
+        FreeBlock* pop() {
+            FreeBlock* block = head;
+            head = block->next;
+            --count;
+            return block;
+        }
+    };
+
+    struct CentralClass {
+        std::mutex mutex;
+        FreeList free;
+    };
+
+    // Shared free lists, refilled from fresh slabs. Deliberately leaked so blocks freed
+    // during static destruction still have somewhere to go.
+    class CentralPool {
+    public:
+        static CentralPool& instance() {
+            static CentralPool* pool = new CentralPool();
+            return *pool;
+        }
+
+        // Moves up to TRANSFER_BATCH blocks of `sizeClass` into `target`.
+        void refill(size_t sizeClass, FreeList& target) {
+            CentralClass& central = classes_[sizeClass];
+            std::lock_guard<std::mutex> lock(central.mutex);
+            if (central.free.count == 0) {
+                carveSlab(sizeClass, central.free);
+            }
+            for (size_t i = 0; i < TRANSFER_BATCH && central.free.count > 0; ++i) {
+                target.push(central.free.pop());
+            }
+        }
+
+        void release(size_t sizeClass, FreeList& source, size_t count) {
+            CentralClass& central = classes_[sizeClass];
+            std::lock_guard<std::mutex> lock(central.mutex);
+            for (size_t i = 0; i < count && source.count > 0; ++i) {
+                central.free.push(source.pop());
+            }
+        }
+
+    private:
+        void carveSlab(size_t sizeClass, FreeList& target) {
+            const size_t blockSize = SIZE_CLASSES[sizeClass];
+            auto* slab = static_cast<char*>(::operator new(SLAB_SIZE, std::align_val_t{BlockPool::BLOCK_ALIGNMENT}));
+            for (size_t offset = 0; offset + blockSize <= SLAB_SIZE; offset += blockSize) {
+                target.push(reinterpret_cast<FreeBlock*>(slab + offset));
+            }
+        }
+
+        std::array<CentralClass, CLASS_COUNT> classes_;
+    };
+
+    // Trivially destructible, so it stays readable while other thread_locals are torn down.
+    thread_local bool threadCacheDestroyed = false;
+
+    struct ThreadCache {
+        std::array<FreeList, CLASS_COUNT> classes;
+
+        ~ThreadCache() {
+            for (size_t i = 0; i < CLASS_COUNT; ++i) {
+                CentralPool::instance().release(i, classes[i], classes[i].count);
+            }
+            threadCacheDestroyed = true;
+        }
+    };
+
+    thread_local ThreadCache threadCache;
+}
+
+void* BlockPool::allocate(size_t bytes) {
+    if (bytes > MAX_POOLED_SIZE) {
+        return ::operator new(bytes, std::align_val_t{BLOCK_ALIGNMENT});
+    }
+    const size_t sizeClass = classFor(bytes);
+    if (threadCacheDestroyed) {
+        FreeList single;
+        CentralPool::instance().refill(sizeClass, single);
+        void* block = single.pop();
+        CentralPool::instance().release(sizeClass, single, single.count);
+        return block;
+    }
+    FreeList& local = threadCache.classes[sizeClass];
+    if (local.count == 0) {
+        CentralPool::instance().refill(sizeClass, local);
+    }
+    return local.pop();
+}
+
+void BlockPool::deallocate(void* block, size_t bytes) noexcept {
+    if (!block) return;
+    if (bytes > MAX_POOLED_SIZE) {
+        ::operator delete(block, std::align_val_t{BLOCK_ALIGNMENT});
+        return;
+    }
+    const size_t sizeClass = classFor(bytes);
+    auto* freeBlock = static_cast<FreeBlock*>(block);
+    if (threadCacheDestroyed) {
+        FreeList single;
+        single.push(freeBlock);
+        CentralPool::instance().release(sizeClass, single, 1);
+        return;
+    }
+    FreeList& local = threadCache.classes[sizeClass];
+    local.push(freeBlock);
+    if (local.count > LOCAL_CACHE_LIMIT) {
+        CentralPool::instance().release(sizeClass, local, TRANSFER_BATCH);
+    }
+}
\ No newline at end of file
@@ -1,47 +1,166 @@
 #include "Channel.h"
+#include "Reactor.h"
 #include <sys/socket.h>
 #include <unistd.h>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 
-Channel::Channel(std::string name)
-    : name_(std::move(name)) {}
+Channel::Channel(std::string name, ChannelId id, HistoryBudget* historyBudget)
+    : name_(std::move(name)), id_(id), current_(std::make_shared<Snapshot>()) {
+    members_.store(current_);
+    if (historyBudget && historyBudget->getLinesPerChannel() > 0) {
+        history_ = std::make_unique<ChannelHistory>(historyBudget->getLinesPerChannel(), historyBudget);
+    }
+}
+
+Channel::~Channel() {
+    // Broadcasts may still hold the last snapshot.
+    current_->retired = std::move(owners_);
+}
+
+Channel::Snapshot::~Snapshot() {
+    // A reader pinning an old snapshot can leave a long chain behind it. Successors freed
+    // while this loop runs hand their own `next` back to it instead of recursing.
+    thread_local std::vector<std::shared_ptr<Snapshot>>* unwinding = nullptr;
+    if (!next) {
+        return;
+    }
+    if (unwinding) {
+        unwinding->push_back(std::move(next));
+        return;
+    }
+    std::vector<std::shared_ptr<Snapshot>> pending;
+    pending.push_back(std::move(next));
+    unwinding = &pending;
+    while (!pending.empty()) {
+        std::shared_ptr<Snapshot> successor = std::move(pending.back());
+        pending.pop_back();
+        successor.reset();
+    }
+    unwinding = nullptr;
+}
 
 const std::string& Channel::getName() const {
     return name_;
 }
 
+ChannelId Channel::getId() const {
+    return id_;
+}
+
+bool Channel::hasMember(const Client& client) const {
+    return client.isInChannel(id_);
+}
+
 size_t Channel::getMemberCount() const {
-    std::lock_guard<std::mutex> lock(members_mutex_);
-    return members_.size();
+    return members_.load()->members.size();
 }
 
 std::vector<std::string> Channel::getMemberNicknames() const {
-    std::lock_guard<std::mutex> lock(members_mutex_);
+    const auto snapshot = members_.load();
     std::vector<std::string> nicknames;
-    nicknames.reserve(members_.size());
-    for (const auto& member : members_) {
+    nicknames.reserve(snapshot->members.size());
+    for (const Client* member : snapshot->members) {
         nicknames.push_back(member->getNickname());
     }
     return nicknames;
 }
 
+std::shared_ptr<const Channel::MemberList> Channel::getMembers() const {
+    auto snapshot = members_.load();
+    const MemberList* members = &snapshot->members;
+    return std::shared_ptr<const MemberList>(std::move(snapshot), members);
+}
+
+void Channel::publish(MemberList members, std::vector<std::shared_ptr<Client>> retired) {
+    auto next = std::make_shared<Snapshot>();
+    next->members = std::move(members);
+    current_->retired = std::move(retired);
+    current_->next = next;
+    current_ = next;
+    members_.store(std::move(next));
+}
+
 void Channel::addClient(std::shared_ptr<Client> client) {
-    std::lock_guard<std::mutex> lock(members_mutex_);
-    members_.insert(client);
+    {
+        std::lock_guard<std::mutex> lock(members_mutex_);
+        const MemberList& current = current_->members;
+        if (std::find(current.begin(), current.end(), client.get()) != current.end()) {
+            return;
+        }
+        MemberList next;
+        next.reserve(current.size() + 1);
+        next = current;
+        next.push_back(client.get());
+        owners_.push_back(client);
+        publish(std::move(next), {});
+    }
     std::clog << "Client " << client->getNickname() << " joined channel " << name_ << std::endl;
 }
 
+void Channel::addClients(const std::vector<std::shared_ptr<Client>>& clients) {
+    size_t added = 0;
+    {
+        std::lock_guard<std::mutex> lock(members_mutex_);
+        const MemberList& current = current_->members;
+        MemberList next;
+        next.reserve(current.size() + clients.size());
+        next = current;
+        for (const auto& client : clients) {
+            if (std::find(current.begin(), current.end(), client.get()) == current.end()) {
+                next.push_back(client.get());
+                owners_.push_back(client);
+                added++;
+            }
+        }
+        publish(std::move(next), {});
+    }
+    std::clog << added << " clients joined channel " << name_ << std::endl;
+}
+
 void Channel::removeClient(std::shared_ptr<Client> client) {
-    std::lock_guard<std::mutex> lock(members_mutex_);
-    members_.erase(client);
+    {
+        std::lock_guard<std::mutex> lock(members_mutex_);
+        const MemberList& current = current_->members;
+        auto it = std::find(current.begin(), current.end(), client.get());
+        if (it != current.end()) {
+            const auto index = static_cast<size_t>(it - current.begin());
+            MemberList next;
+            next.reserve(current.size() - 1);
+            next.insert(next.end(), current.begin(), it);
+            next.insert(next.end(), it + 1, current.end());
+            std::vector<std::shared_ptr<Client>> retired{std::move(owners_[index])};
+            owners_.erase(owners_.begin() + static_cast<std::ptrdiff_t>(index));
+            publish(std::move(next), std::move(retired));
+        }
+    }
     std::clog << "Client " << client->getNickname() << " left channel " << name_ << std::endl;
 }
 
 void Channel::broadcastMessage(const std::string& message) {
-    std::lock_guard<std::mutex> lock(members_mutex_);
-    std::string formatted_message = message + "\n";
-    for (const auto& member : members_) {
-        member->pushMessageToQueue(formatted_message);
+    broadcastMessage(MessagePayload::concat({message, "\n"}));
+}
+
+void Channel::broadcastMessage(const PayloadRef& message) {
+    const auto snapshot = members_.load();
+    DeliveryBatch batch(message, snapshot);
+    for (Client* member : snapshot->members) {
+        batch.add(member);
     }
+    batch.dispatch();
+}
+
+bool Channel::hasHistory() const {
+    return history_ != nullptr;
+}
+
+void Channel::recordHistory(PayloadRef line) {
+    if (history_) {
+        history_->append(std::move(line));
+    }
+}
+
+std::vector<PayloadRef> Channel::getHistory() const {
+    return history_ ? history_->snapshot() : std::vector<PayloadRef>{};
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "ChannelHistory.h"
+#include "LatencyMetrics.h"
+#include <algorithm>
+
+ChannelHistory::ChannelHistory(size_t capacity, HistoryBudget* budget)
+    : capacity_(capacity), budget_(budget), ring_(capacity) {
+    lastUsed_.store(LatencyMetrics::now(), std::memory_order_relaxed);
+    if (budget_) {
+        budget_->registerHistory(this);
+    }
+}
+
+ChannelHistory::~ChannelHistory() {
+    if (budget_) {
+        budget_->unregisterHistory(this);
+        budget_->release(bytes_.load(std::memory_order_relaxed));
+    }
+}
+
+void ChannelHistory::append(PayloadRef line) {
+    if (capacity_ == 0 || !line) return;
+    const size_t added = line->size();
+    size_t evicted = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PayloadRef& slot = ring_[(head_ + count_) % capacity_];
+        if (count_ == capacity_) {
+            evicted = slot->size();
+            head_ = (head_ + 1) % capacity_;
+        } else {
+            ++count_;
+        }
+        slot = std::move(line);
+        bytes_.store(bytes_.load(std::memory_order_relaxed) + added - evicted, std::memory_order_relaxed);
+    }
+    lastUsed_.store(LatencyMetrics::now(), std::memory_order_relaxed);
+    if (budget_) {
+        budget_->release(evicted);
+        budget_->charge(this, added);
+    }
+}
+
+std::vector<PayloadRef> ChannelHistory::snapshot() {
+    lastUsed_.store(LatencyMetrics::now(), std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<PayloadRef> lines;
+    lines.reserve(count_);
+    for (size_t i = 0; i < count_; ++i) {
+        lines.push_back(ring_[(head_ + i) % capacity_]);
+    }
+    return lines;
+}
+
+size_t ChannelHistory::getBytes() const {
+    return bytes_.load(std::memory_order_relaxed);
+}
+
+uint64_t ChannelHistory::getLastUsed() const {
+    return lastUsed_.load(std::memory_order_relaxed);
+}
+
+size_t ChannelHistory::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count_; ++i) {
+        ring_[(head_ + i) % capacity_].reset();
+    }
+    head_ = 0;
+    count_ = 0;
+    return bytes_.exchange(0, std::memory_order_relaxed);
+}
+
+size_t ChannelHistory::trimOldest(size_t bytesWanted) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t released = 0;
+    while (count_ > 0 && released < bytesWanted) {
+        PayloadRef& oldest = ring_[head_];
+        released += oldest->size();
+        oldest.reset();
+        head_ = (head_ + 1) % capacity_;
+        --count_;
+    }
+    bytes_.store(bytes_.load(std::memory_order_relaxed) - released, std::memory_order_relaxed);
+    return released;
+}
+
+HistoryBudget::HistoryBudget(size_t linesPerChannel, size_t maxBytes)
+    : linesPerChannel_(linesPerChannel), maxBytes_(maxBytes) {}
+
+size_t HistoryBudget::getLinesPerChannel() const { return linesPerChannel_; }
+size_t HistoryBudget::getMaxBytes() const { return maxBytes_; }
+size_t HistoryBudget::getUsedBytes() const { return usedBytes_.load(std::memory_order_relaxed); }
+size_t HistoryBudget::getEvictionCount() const { return evictions_.load(std::memory_order_relaxed); }
+
+void HistoryBudget::registerHistory(ChannelHistory* history) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histories_.push_back(history);
+}
+
+void HistoryBudget::unregisterHistory(ChannelHistory* history) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase(histories_, history);
+}
+
+void HistoryBudget::release(size_t bytes) {
+    if (bytes > 0) {
+        usedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+}
+
+void HistoryBudget::charge(ChannelHistory* source, size_t bytes) {
+    if (usedBytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes <= maxBytes_) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (usedBytes_.load(std::memory_order_relaxed) > maxBytes_) {
+        ChannelHistory* coldest = nullptr;
+        for (ChannelHistory* history : histories_) {
+            if (history != source && history->getBytes() > 0 &&
+                (!coldest || history->getLastUsed() < coldest->getLastUsed())) {
+                coldest = history;
+            }
+        }
+        if (!coldest) {
+            release(source->trimOldest(usedBytes_.load(std::memory_order_relaxed) - maxBytes_));
+            break;
+        }
+        release(coldest->clear());
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
\ No newline at end of file
@@ -1,9 +1,16 @@
 #include "ChannelManager.h"
 #include <algorithm>
 #include <iostream>
+#include <functional>
 
-ChannelManager::ChannelManager(int maxChannels)
-    : maxChannels_(maxChannels) {}
+ChannelManager::ChannelManager(int maxChannels, HistoryBudget* historyBudget)
+    : channelsById_(std::make_unique<std::atomic<std::shared_ptr<Channel>>[]>(std::clamp<int>(maxChannels, 0, Client::MAX_CHANNEL_IDS))),
+      maxChannels_(std::clamp<int>(maxChannels, 0, Client::MAX_CHANNEL_IDS)),
+      historyBudget_(historyBudget) {
+    for (int id = maxChannels_ - 1; id >= 0; --id) {
+        freeChannelIds_.push_back(static_cast<ChannelId>(id));
+    }
+}
 
 bool ChannelManager::isValidChannelName(const std::string& channelName) const {
     if (channelName.empty() || channelName.length() > 50) {
@@ -19,140 +26,227 @@ bool ChannelManager::isValidChannelName(const std::string& channelName) const {
         [](char c) { return std::isprint(c) && !std::isspace(c); });
 }
 
-bool ChannelManager::canCreateNewChannel_UNLOCKED() const {
-    return static_cast<int>(channels_.size()) < maxChannels_;
+bool ChannelManager::reserveChannelSlot() {
+    int count = channelCount_.load(std::memory_order_relaxed);
+    do {
+        if (count >= maxChannels_) {
+            return false;
+        }
+    } while (!channelCount_.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+    return true;
 }
 
-bool ChannelManager::createChannel_UNLOCKED(const std::string& channelName) {
-    if (!isValidChannelName(channelName) || channels_.count(channelName) > 0 || !canCreateNewChannel_UNLOCKED()) {
-        return false;
+ChannelManager::Shard& ChannelManager::shardFor(const std::string& channelName) {
+    return shards_[std::hash<std::string>{}(channelName) % SHARD_COUNT];
+}
+
+const ChannelManager::Shard& ChannelManager::shardFor(const std::string& channelName) const {
+    return shards_[std::hash<std::string>{}(channelName) % SHARD_COUNT];
+}
+
+std::shared_ptr<Channel> ChannelManager::createChannel_UNLOCKED(Shard& shard, const std::string& channelName) {
+    if (!isValidChannelName(channelName) || shard.channels.count(channelName) > 0 || !reserveChannelSlot()) {
+        return nullptr;
     }
-    channels_[channelName] = std::make_unique<Channel>(channelName);
-    return true;
+    auto channel = std::make_shared<Channel>(channelName, acquireChannelId(), historyBudget_);
+    channelsById_[channel->getId()].store(channel);
+    shard.channels.emplace(channelName, channel);
+    return channel;
+}
+
+// reserveChannelSlot() has already guaranteed that a free id exists.
+ChannelId ChannelManager::acquireChannelId() {
+    std::lock_guard<std::mutex> lock(channelIdsMutex_);
+    const ChannelId channelId = freeChannelIds_.back();
+    freeChannelIds_.pop_back();
+    return channelId;
+}
+
+void ChannelManager::releaseChannelId(ChannelId channelId) {
+    channelsById_[channelId].store(nullptr);
+    std::lock_guard<std::mutex> lock(channelIdsMutex_);
+    freeChannelIds_.push_back(channelId);
 }
 
 bool ChannelManager::createChannel(const std::string& channelName) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    return createChannel_UNLOCKED(channelName);
+    Shard& shard = shardFor(channelName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    return createChannel_UNLOCKED(shard, channelName) != nullptr;
 }
 
 bool ChannelManager::removeChannel(const std::string& channelName) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    auto it = channels_.find(channelName);
-    if (it == channels_.end()) {
+    Shard& shard = shardFor(channelName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.channels.find(channelName);
+    if (it == shard.channels.end()) {
         return false;
     }
-    channels_.erase(it);
+    const std::shared_ptr<Channel> channel = std::move(it->second);
+    shard.channels.erase(it);
+    for (const auto& member : *channel->getMembers()) {
+        member->leaveChannel(channel->getId());
+    }
+    releaseChannelId(channel->getId());
+    channelCount_.fetch_sub(1, std::memory_order_relaxed);
     return true;
 }
 
 bool ChannelManager::channelExists(const std::string& channelName) const {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    return channels_.count(channelName) > 0;
+    const Shard& shard = shardFor(channelName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.channels.count(channelName) > 0;
 }
 
-std::optional<std::reference_wrapper<Channel>> ChannelManager::getChannel(const std::string& channelName) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    auto it = channels_.find(channelName);
-    if (it != channels_.end()) {
-        return std::ref(*it->second);
-    }
-    return std::nullopt;
+std::shared_ptr<Channel> ChannelManager::getChannel(const std::string& channelName) const {
+    const Shard& shard = shardFor(channelName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.channels.find(channelName);
+    return it != shard.channels.end() ? it->second : nullptr;
 }
 
-std::optional<std::reference_wrapper<const Channel>> ChannelManager::getChannel(const std::string& channelName) const {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    auto it = channels_.find(channelName);
-    if (it != channels_.end()) {
-        return std::cref(*it->second);
+std::shared_ptr<Channel> ChannelManager::getChannel(ChannelId channelId) const {
+    if (channelId >= static_cast<ChannelId>(std::max(maxChannels_, 0))) {
+        return nullptr;
     }
-    return std::nullopt;
+    return channelsById_[channelId].load();
 }
 
 bool ChannelManager::joinChannel(std::shared_ptr<Client> client, const std::string& channelName) {
     if (!client || !isValidChannelName(channelName)) {
         return false;
     }
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    if (channels_.count(channelName) == 0) {
-        if (!createChannel_UNLOCKED(channelName)) {
-            return false;
+    Shard& shard = shardFor(channelName);
+    {
+        // Membership changes happen under the shard lock so a concurrent removeChannel
+        // cannot leave the client in a channel that is no longer registered.
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.channels.find(channelName);
+        if (it != shard.channels.end()) {
+            it->second->addClient(client);
+            client->joinChannel(it->second->getId());
+            return true;
         }
     }
-    channels_.at(channelName)->addClient(client);
-    client->joinChannel(channelName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.channels.find(channelName);
+    std::shared_ptr<Channel> channel = it != shard.channels.end() ? it->second : createChannel_UNLOCKED(shard, channelName);
+    if (!channel) {
+        return false;
+    }
+    channel->addClient(client);
+    client->joinChannel(channel->getId());
+    return true;
+}
+
+bool ChannelManager::restoreChannel(const std::string& channelName, const std::vector<std::shared_ptr<Client>>& members) {
+    Shard& shard = shardFor(channelName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.channels.find(channelName);
+    std::shared_ptr<Channel> channel = it != shard.channels.end() ? it->second : createChannel_UNLOCKED(shard, channelName);
+    if (!channel) {
+        return false;
+    }
+    channel->addClients(members);
+    for (const auto& member : members) {
+        member->joinChannel(channel->getId());
+    }
     return true;
 }
 
 bool ChannelManager::leaveChannel(std::shared_ptr<Client> client, const std::string& channelName) {
     if (!client) return false;
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    auto it = channels_.find(channelName);
-    if (it == channels_.end()) {
+    Shard& shard = shardFor(channelName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.channels.find(channelName);
+    if (it == shard.channels.end()) {
         return false;
     }
     it->second->removeClient(client);
-    client->leaveChannel(channelName);
+    client->leaveChannel(it->second->getId());
+    return true;
+}
+
+bool ChannelManager::leaveChannel(const std::shared_ptr<Client>& client, Channel& channel) {
+    if (!client || !channel.hasMember(*client)) return false;
+    channel.removeClient(client);
+    client->leaveChannel(channel.getId());
     return true;
 }
 
 void ChannelManager::removeClientFromAllChannels(std::shared_ptr<Client> client) {
     if (!client) return;
-    const auto channelSet = client->getJoinedChannels();
-    std::vector<std::string> clientChannels(channelSet.begin(), channelSet.end());
-    for (const auto& channelName : clientChannels) {
-        leaveChannel(client, channelName);
+    const std::vector<ChannelId> channelIds = client->getJoinedChannels();
+    for (ChannelId channelId : channelIds) {
+        if (auto channel = getChannel(channelId)) {
+            channel->removeClient(client);
+        }
+        client->leaveChannel(channelId);
     }
 }
 
 void ChannelManager::broadcastToChannel(const std::string& channelName, const std::string& message) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    auto it = channels_.find(channelName);
-    if (it != channels_.end()) {
-        it->second->broadcastMessage(message);
+    broadcastToChannel(channelName, MessagePayload::concat({message, "\n"}));
+}
+
+void ChannelManager::broadcastToChannel(const std::string& channelName, const PayloadRef& message) {
+    if (auto channel = getChannel(channelName)) {
+        channel->broadcastMessage(message);
     }
 }
 
 void ChannelManager::broadcastToAllChannels(const std::string& message) {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    for (const auto& [name, channel] : channels_) {
-        channel->broadcastMessage(message);
+    const PayloadRef payload = MessagePayload::concat({message, "\n"});
+    for (const auto& channel : snapshotChannels()) {
+        channel->broadcastMessage(payload);
     }
 }
 
+std::vector<std::shared_ptr<Channel>> ChannelManager::snapshotChannels() const {
+    std::vector<std::shared_ptr<Channel>> channels;
+    channels.reserve(getChannelCount());
+    for (const Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [channelName, channel] : shard.channels) {
+            channels.push_back(channel);
+        }
+    }
+    return channels;
+}
+
 std::vector<std::string> ChannelManager::getChannelList() const {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
     std::vector<std::string> channelNames;
-    channelNames.reserve(channels_.size());
-    for (const auto& [channelName, channel] : channels_) {
-        channelNames.push_back(channelName);
+    channelNames.reserve(getChannelCount());
+    for (const Shard& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [channelName, channel] : shard.channels) {
+            channelNames.push_back(channelName);
+        }
     }
     std::sort(channelNames.begin(), channelNames.end());
     return channelNames;
 }
 
 size_t ChannelManager::getChannelCount() const {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    return channels_.size();
+    return static_cast<size_t>(channelCount_.load(std::memory_order_relaxed));
 }
 
 size_t ChannelManager::getChannelMemberCount(const std::string& channelName) const {
-    std::lock_guard<std::mutex> lock(channels_mutex_);
-    auto it = channels_.find(channelName);
-    if (it != channels_.end()) {
-        return it->second->getMemberCount();
-    }
-    return 0;
+    auto channel = getChannel(channelName);
+    return channel ? channel->getMemberCount() : 0;
 }
 
 std::vector<std::string> ChannelManager::getClientChannels(std::shared_ptr<Client> client) const {
     if (!client) {
         return {};
     }
-    const auto& channelSet = client->getJoinedChannels();
-    std::vector<std::string> channelVector(channelSet.begin(), channelSet.end());
-    std::sort(channelVector.begin(), channelVector.end());
-    return channelVector;
+    std::vector<std::string> channelNames;
+    for (ChannelId channelId : client->getJoinedChannels()) {
+        if (auto channel = getChannel(channelId)) {
+            channelNames.push_back(channel->getName());
+        }
+    }
+    std::sort(channelNames.begin(), channelNames.end());
+    return channelNames;
 }
 
 int ChannelManager::getMaxChannels() const {
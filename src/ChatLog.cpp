@@ -0,0 +1,263 @@
+#include "ChatLog.h"
+#include "ChatLogSegment.h"
+#include "BlockPool.h"
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+#include <filesystem>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ChatLogFormat;
+
+ChatLog::Record* ChatLog::Record::create(uint32_t size) {
+    void* memory = BlockPool::allocate(sizeof(Record) + size);
+    auto* record = new (memory) Record;
+    record->size = size;
+    return record;
+}
+
+void ChatLog::Record::destroy(Record* record) {
+    const size_t bytes = sizeof(Record) + record->size;
+    record->~Record();
+    BlockPool::deallocate(record, bytes);
+}
+
+ChatLog::ChatLog(std::string directory, size_t segmentSize, std::chrono::milliseconds syncInterval)
+    : directory_(std::move(directory)), segmentSize_(segmentSize), syncInterval_(syncInterval) {
+    std::filesystem::create_directories(directory_);
+    const auto segments = ChatLogSegment::list(directory_);
+    // Never append to an existing segment: its tail may be torn from a crash.
+    openSegment(segments.empty() ? 1 : segments.back().first + 1);
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd_ == -1) {
+        const int error = errno;
+        close(segmentFd_);
+        throw std::system_error(error, std::system_category(), "Failed to create chat log eventfd");
+    }
+}
+
+ChatLog::~ChatLog() {
+    stopping_ = true;
+    wakeup();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    // The writer may have stopped between a producer's push and its wakeup.
+    std::vector<Record*> batch;
+    drainQueue(batch);
+    writeBatch(batch);
+    if (unsynced_) {
+        syncSegment();
+    }
+    close(segmentFd_);
+    close(wakeFd_);
+}
+
+void ChatLog::start() {
+    thread_ = std::thread([this] { run(); });
+}
+
+void ChatLog::appendChannelMessage(std::string_view sender, std::string_view channel, std::string_view text) {
+    append(RecordType::Channel, sender, channel, text);
+}
+
+void ChatLog::appendPrivateMessage(std::string_view sender, std::string_view recipient, std::string_view text) {
+    append(RecordType::Private, sender, recipient, text);
+}
+
+void ChatLog::append(RecordType type, std::string_view sender, std::string_view target, std::string_view text) {
+    sender = sender.substr(0, MAX_FIELD_LENGTH);
+    target = target.substr(0, MAX_FIELD_LENGTH);
+    text = text.substr(0, MAX_FIELD_LENGTH);
+    const auto size = static_cast<uint32_t>(recordSize(sender.size(), target.size(), text.size()));
+
+    RecordHeader header{};
+    header.length = size - static_cast<uint32_t>(LENGTH_FIELD_SIZE);
+    header.timestampMicros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header.type = type;
+    header.senderLength = static_cast<uint16_t>(sender.size());
+    header.targetLength = static_cast<uint16_t>(target.size());
+    header.textLength = static_cast<uint16_t>(text.size());
+
+    // The checksum is left to the writer thread.
+    Record* record = Record::create(size);
+    char* out = record->data();
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (std::string_view field : {sender, target, text}) {
+        std::memcpy(out, field.data(), field.size());
+        out += field.size();
+    }
+    queue_.push(record);
+    if (!signalled_.exchange(true)) {
+        wakeup();
+    }
+}
+
+void ChatLog::wakeup() {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto written = write(wakeFd_, &one, sizeof(one));
+}
+
+void ChatLog::run() {
+    std::vector<Record*> batch;
+    auto lastSync = std::chrono::steady_clock::now();
+    while (true) {
+        uint64_t value;
+        [[maybe_unused]] auto drained = read(wakeFd_, &value, sizeof(value));
+        signalled_ = false;
+        drainQueue(batch);
+        writeBatch(batch);
+        batch.clear();
+
+        const auto now = std::chrono::steady_clock::now();
+        const bool stopping = stopping_.load();
+        if (unsynced_ && (stopping || now - lastSync >= syncInterval_)) {
+            syncSegment();
+            lastSync = now;
+        }
+        if (stopping) {
+            return;
+        }
+
+        int timeoutMs = -1;
+        if (unsynced_) {
+            const auto due = std::chrono::duration_cast<std::chrono::milliseconds>(lastSync + syncInterval_ - now);
+            timeoutMs = static_cast<int>(std::max<int64_t>(due.count(), 0));
+        }
+        pollfd wake{wakeFd_, POLLIN, 0};
+        if (poll(&wake, 1, timeoutMs) == -1 && errno != EINTR) {
+            std::cerr << "Chat log poll failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+    }
+}
+
+void ChatLog::drainQueue(std::vector<Record*>& batch) {
+    while (Record* record = queue_.pop()) {
+        batch.push_back(record);
+    }
+}
+
+void ChatLog::writeBatch(const std::vector<Record*>& batch) {
+    std::vector<iovec> iov;
+    iov.reserve(std::min<size_t>(batch.size(), IOV_MAX));
+    size_t pendingBytes = 0;
+    for (Record* record : batch) {
+        char* data = record->data();
+        const uint32_t recordChecksum = checksum(data + CHECKSUMMED_OFFSET, record->size - CHECKSUMMED_OFFSET);
+        std::memcpy(data + LENGTH_FIELD_SIZE, &recordChecksum, sizeof(recordChecksum));
+
+        const bool segmentHasRecords = segmentBytes_ + pendingBytes > sizeof(SegmentHeader);
+        if (segmentHasRecords && segmentBytes_ + pendingBytes + record->size > segmentSize_) {
+            writeFully(iov);
+            pendingBytes = 0;
+            rotateSegment();
+        }
+        iov.push_back({data, record->size});
+        pendingBytes += record->size;
+        if (iov.size() == IOV_MAX) {
+            writeFully(iov);
+            pendingBytes = 0;
+        }
+    }
+    writeFully(iov);
+    for (Record* record : batch) {
+        Record::destroy(record);
+    }
+}
+
+// Every entry is one whole record.
+void ChatLog::writeFully(std::vector<iovec>& iov) {
+    const size_t recordCount = iov.size();
+    size_t bytes = 0;
+    for (const iovec& entry : iov) {
+        bytes += entry.iov_len;
+    }
+    size_t index = 0;
+    while (index < iov.size()) {
+        const ssize_t written = writev(segmentFd_, iov.data() + index, static_cast<int>(iov.size() - index));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Chat log write failed, dropping " << recordCount << " records: " << std::strerror(errno) << std::endl;
+            failedRecords_.fetch_add(recordCount, std::memory_order_relaxed);
+            iov.clear();
+            return;
+        }
+        size_t remaining = static_cast<size_t>(written);
+        while (index < iov.size() && remaining >= iov[index].iov_len) {
+            remaining -= iov[index].iov_len;
+            ++index;
+        }
+        if (remaining > 0) {
+            iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + remaining;
+            iov[index].iov_len -= remaining;
+        }
+    }
+    if (recordCount > 0) {
+        segmentBytes_ += bytes;
+        unsynced_ = true;
+        writtenRecords_.fetch_add(recordCount, std::memory_order_relaxed);
+        writtenBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    iov.clear();
+}
+
+void ChatLog::openSegment(uint64_t sequence) {
+    const std::string path = ChatLogSegment::pathFor(directory_, sequence);
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::system_error(errno, std::system_category(), "Failed to create log segment " + path);
+    }
+    SegmentHeader header{};
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    header.version = SEGMENT_VERSION;
+    if (write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::system_category(), "Failed to write log segment header " + path);
+    }
+    // Make the new file name itself durable.
+    const int directoryFd = open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directoryFd != -1) {
+        fsync(directoryFd);
+        close(directoryFd);
+    }
+    segmentFd_ = fd;
+    segmentSequence_ = sequence;
+    segmentBytes_ = sizeof(header);
+    unsynced_ = true;
+}
+
+void ChatLog::rotateSegment() {
+    syncSegment();
+    const int previous = segmentFd_;
+    try {
+        openSegment(segmentSequence_ + 1);
+        close(previous);
+    } catch (const std::system_error& e) {
+        // Keep appending to the old segment rather than losing records.
+        std::cerr << "Chat log rotation failed: " << e.what() << std::endl;
+    }
+}
+
+void ChatLog::syncSegment() {
+    if (fdatasync(segmentFd_) == -1) {
+        std::cerr << "Chat log fsync failed: " << std::strerror(errno) << std::endl;
+    }
+    unsynced_ = false;
+    syncCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+const std::string& ChatLog::getDirectory() const { return directory_; }
+size_t ChatLog::getWrittenRecords() const { return writtenRecords_.load(std::memory_order_relaxed); }
+size_t ChatLog::getWrittenBytes() const { return writtenBytes_.load(std::memory_order_relaxed); }
+size_t ChatLog::getFailedRecords() const { return failedRecords_.load(std::memory_order_relaxed); }
+size_t ChatLog::getSyncCount() const { return syncCount_.load(std::memory_order_relaxed); }
\ No newline at end of file
@@ -0,0 +1,312 @@
+#include "ChatLogIndex.h"
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <system_error>
+
+ChatLogIndex::ChatLogIndex(std::string directory, bool tokenIndex)
+    : directory_(std::move(directory)), tokenIndex_(tokenIndex) {}
+
+void ChatLogIndex::refresh() {
+    std::vector<std::pair<uint64_t, std::string>> listed;
+    try {
+        listed = ChatLogSegment::list(directory_);
+    } catch (const std::system_error& e) {
+        std::cerr << "Failed to list chat log segments: " << e.what() << std::endl;
+        return;
+    }
+    std::erase_if(segments_, [&](const SegmentIndex& index) {
+        const bool gone = !std::binary_search(listed.begin(), listed.end(), std::make_pair(index.sequence, index.path));
+        if (gone) {
+            indexedRecords_ -= index.records;
+            memoryUsage_ -= index.memoryUsage;
+        }
+        return gone;
+    });
+    for (auto& [sequence, path] : listed) {
+        if (segments_.empty() || segments_.back().sequence < sequence) {
+            SegmentIndex index;
+            index.sequence = sequence;
+            index.path = std::move(path);
+            segments_.push_back(std::move(index));
+        }
+    }
+    // The writer has finished a segment once a newer one exists in the listing.
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        if (!segments_[i].sealed) {
+            indexSegment(segments_[i]);
+            segments_[i].sealed = i + 1 < segments_.size();
+        }
+    }
+}
+
+void ChatLogIndex::indexSegment(SegmentIndex& index) {
+    std::unique_ptr<ChatLogSegment> segment;
+    try {
+        segment = std::make_unique<ChatLogSegment>(index.path);
+    } catch (const std::system_error& e) {
+        std::cerr << "Failed to index chat log segment: " << e.what() << std::endl;
+        return;
+    }
+    if (segment->getSize() <= index.indexedEnd) {
+        return;
+    }
+    const size_t memoryBefore = index.memoryUsage;
+    index.indexedEnd = segment->forEach([&](const ChatLogEntry& entry) {
+        index.records++;
+        indexedRecords_++;
+        index.lastTimestampMicros = std::max(index.lastTimestampMicros, entry.timestampMicros);
+        if (entry.type == ChatLogFormat::RecordType::Channel) {
+            auto it = index.channels.find(entry.target);
+            if (it == index.channels.end()) {
+                it = index.channels.emplace(std::string(entry.target), ChannelIndex{}).first;
+                index.memoryUsage += sizeof(ChannelIndex) + entry.target.size();
+            }
+            ChannelIndex& channel = it->second;
+            if (channel.count % CHECKPOINT_INTERVAL == 0) {
+                channel.checkpoints.push_back({entry.timestampMicros, entry.offset});
+                index.memoryUsage += sizeof(Checkpoint);
+            }
+            channel.count++;
+        }
+        if (tokenIndex_) {
+            indexTokens(index, entry);
+        }
+        return true;
+    }, index.indexedEnd);
+    memoryUsage_ += index.memoryUsage - memoryBefore;
+}
+
+void ChatLogIndex::indexTokens(SegmentIndex& index, const ChatLogEntry& entry) {
+    std::vector<uint32_t> hashes;
+    for (const auto& token : tokenize(entry.text)) {
+        hashes.push_back(hashToken(token));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+    for (uint32_t hash : hashes) {
+        auto [it, inserted] = index.tokens.try_emplace(hash);
+        Postings& postings = it->second;
+        if (inserted) {
+            index.memoryUsage += sizeof(uint32_t) + sizeof(Postings);
+        }
+        uint64_t delta = entry.offset - postings.lastOffset;
+        postings.lastOffset = entry.offset;
+        do {
+            const uint8_t byte = static_cast<uint8_t>(delta & 0x7f);
+            delta >>= 7;
+            postings.deltas.push_back(delta ? (byte | 0x80) : byte);
+            index.memoryUsage++;
+        } while (delta);
+    }
+}
+
+std::vector<uint64_t> ChatLogIndex::tokenCandidates(const SegmentIndex& index, const std::vector<uint32_t>& hashes) const {
+    std::vector<uint64_t> candidates;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        const auto it = index.tokens.find(hashes[i]);
+        if (it == index.tokens.end()) {
+            return {};
+        }
+        std::vector<uint64_t> offsets;
+        uint64_t offset = 0;
+        uint64_t delta = 0;
+        int shift = 0;
+        for (uint8_t byte : it->second.deltas) {
+            delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) {
+                offset += delta;
+                offsets.push_back(offset);
+                delta = 0;
+                shift = 0;
+            }
+        }
+        if (i == 0) {
+            candidates = std::move(offsets);
+        } else {
+            std::vector<uint64_t> both;
+            std::set_intersection(candidates.begin(), candidates.end(), offsets.begin(), offsets.end(), std::back_inserter(both));
+            candidates = std::move(both);
+        }
+        if (candidates.empty()) {
+            break;
+        }
+    }
+    return candidates;
+}
+
+size_t ChatLogIndex::findChannelMessages(std::string_view channel, uint64_t sinceMicros, size_t limit, const EntryHandler& onEntry) const {
+    std::vector<SegmentHits> hits;
+    size_t remaining = limit;
+    for (auto it = segments_.rbegin(); it != segments_.rend() && remaining > 0; ++it) {
+        const SegmentIndex& index = *it;
+        if (index.records > 0 && index.lastTimestampMicros < sinceMicros) {
+            break;
+        }
+        const auto channelIt = index.channels.find(channel);
+        if (channelIt == index.channels.end()) {
+            continue;
+        }
+        // Start at the later of the checkpoint covering the last `remaining` messages
+        // and the last checkpoint before `sinceMicros`.
+        const ChannelIndex& channelIndex = channelIt->second;
+        const auto& checkpoints = channelIndex.checkpoints;
+        size_t first = channelIndex.count > remaining ? (channelIndex.count - remaining) / CHECKPOINT_INTERVAL : 0;
+        const auto afterSince = std::partition_point(checkpoints.begin(), checkpoints.end(),
+            [sinceMicros](const Checkpoint& checkpoint) { return checkpoint.timestampMicros < sinceMicros; });
+        if (afterSince != checkpoints.begin()) {
+            first = std::max<size_t>(first, afterSince - checkpoints.begin() - 1);
+        }
+
+        SegmentHits segmentHits;
+        try {
+            segmentHits.segment = std::make_unique<ChatLogSegment>(index.path);
+        } catch (const std::system_error&) {
+            continue;
+        }
+        std::deque<uint64_t> window;
+        segmentHits.segment->forEach([&](const ChatLogEntry& entry) {
+            if (entry.type == ChatLogFormat::RecordType::Channel && entry.target == channel && entry.timestampMicros >= sinceMicros) {
+                window.push_back(entry.offset);
+                if (window.size() > remaining) {
+                    window.pop_front();
+                }
+            }
+            return true;
+        }, checkpoints[first].offset);
+        if (window.empty()) {
+            continue;
+        }
+        remaining -= window.size();
+        segmentHits.offsets.assign(window.begin(), window.end());
+        hits.push_back(std::move(segmentHits));
+    }
+    std::reverse(hits.begin(), hits.end());
+    return deliver(hits, onEntry);
+}
+
+size_t ChatLogIndex::grep(std::string_view query, std::string_view channel, size_t limit, const EntryHandler& onEntry) const {
+    std::vector<std::string> words = tokenize(query);
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    if (words.empty()) {
+        return 0;
+    }
+    std::vector<uint32_t> hashes;
+    for (const auto& word : words) {
+        hashes.push_back(hashToken(word));
+    }
+    // Confirms index candidates too, since different words may share a hash.
+    auto matches = [&](const ChatLogEntry& entry) {
+        if (!channel.empty() && (entry.type != ChatLogFormat::RecordType::Channel || entry.target != channel)) {
+            return false;
+        }
+        std::vector<std::string> entryWords = tokenize(entry.text);
+        return std::all_of(words.begin(), words.end(), [&](const std::string& word) {
+            return std::find(entryWords.begin(), entryWords.end(), word) != entryWords.end();
+        });
+    };
+
+    std::vector<SegmentHits> hits;
+    size_t remaining = limit;
+    for (auto it = segments_.rbegin(); it != segments_.rend() && remaining > 0; ++it) {
+        const SegmentIndex& index = *it;
+        if (!channel.empty() && index.sealed && !index.channels.contains(channel)) {
+            continue;
+        }
+        SegmentHits segmentHits;
+        try {
+            segmentHits.segment = std::make_unique<ChatLogSegment>(index.path);
+        } catch (const std::system_error&) {
+            continue;
+        }
+        const ChatLogSegment& segment = *segmentHits.segment;
+        std::deque<uint64_t> window;
+        auto scan = [&](uint64_t from) {
+            segment.forEach([&](const ChatLogEntry& entry) {
+                if (matches(entry)) {
+                    window.push_back(entry.offset);
+                    if (window.size() > remaining) {
+                        window.pop_front();
+                    }
+                }
+                return true;
+            }, from);
+        };
+        if (tokenIndex_) {
+            // Records past indexedEnd are newer than anything indexed, so scan them first.
+            scan(index.indexedEnd);
+            const auto candidates = tokenCandidates(index, hashes);
+            ChatLogEntry entry;
+            for (auto candidate = candidates.rbegin(); candidate != candidates.rend() && window.size() < remaining; ++candidate) {
+                if (segment.read(*candidate, entry) && matches(entry)) {
+                    window.push_front(entry.offset);
+                }
+            }
+        } else {
+            scan(sizeof(ChatLogFormat::SegmentHeader));
+        }
+        if (window.empty()) {
+            continue;
+        }
+        remaining -= window.size();
+        segmentHits.offsets.assign(window.begin(), window.end());
+        hits.push_back(std::move(segmentHits));
+    }
+    std::reverse(hits.begin(), hits.end());
+    return deliver(hits, onEntry);
+}
+
+size_t ChatLogIndex::deliver(std::vector<SegmentHits>& hits, const EntryHandler& onEntry) {
+    size_t delivered = 0;
+    ChatLogEntry entry;
+    for (auto& segmentHits : hits) {
+        for (uint64_t offset : segmentHits.offsets) {
+            if (segmentHits.segment->read(offset, entry)) {
+                onEntry(entry);
+                delivered++;
+            }
+        }
+        segmentHits.segment.reset();
+    }
+    return delivered;
+}
+
+size_t ChatLogIndex::getIndexedRecords() const {
+    return indexedRecords_;
+}
+
+size_t ChatLogIndex::getSegmentCount() const {
+    return segments_.size();
+}
+
+size_t ChatLogIndex::getMemoryUsage() const {
+    return memoryUsage_;
+}
+
+std::vector<std::string> ChatLogIndex::tokenize(std::string_view text) {
+    std::vector<std::string> tokens;
+    std::string token;
+    auto finish = [&] {
+        if (token.size() >= MIN_TOKEN_LENGTH) {
+            tokens.push_back(token);
+        }
+        token.clear();
+    };
+    for (char c : text) {
+        const auto byte = static_cast<unsigned char>(c);
+        const bool isWordByte = (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z') || byte >= 0x80;
+        if (!isWordByte) {
+            finish();
+        } else if (token.size() < MAX_TOKEN_LENGTH) {
+            token.push_back(byte >= 'A' && byte <= 'Z' ? static_cast<char>(byte - 'A' + 'a') : c);
+        }
+    }
+    finish();
+    return tokens;
+}
+
+uint32_t ChatLogIndex::hashToken(std::string_view token) {
+    return ChatLogFormat::checksum(token.data(), token.size());
+}
\ No newline at end of file
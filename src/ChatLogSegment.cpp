@@ -0,0 +1,110 @@
+#include "ChatLogSegment.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace ChatLogFormat;
+
+ChatLogSegment::ChatLogSegment(const std::string& path) : path_(path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::system_error(errno, std::system_category(), "Failed to open log segment " + path);
+    }
+    struct stat info{};
+    if (fstat(fd, &info) == -1) {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::system_category(), "Failed to stat log segment " + path);
+    }
+    // A segment that crashed before its header was written holds no records.
+    if (static_cast<size_t>(info.st_size) < sizeof(SegmentHeader)) {
+        close(fd);
+        return;
+    }
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(error, std::system_category(), "Failed to map log segment " + path);
+    }
+    data_ = static_cast<const char*>(mapping);
+    size_ = static_cast<size_t>(info.st_size);
+    SegmentHeader header;
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0 || header.version != SEGMENT_VERSION) {
+        munmap(const_cast<char*>(data_), size_);
+        throw std::system_error(EINVAL, std::system_category(), "Not a chat log segment: " + path);
+    }
+}
+
+ChatLogSegment::~ChatLogSegment() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+bool ChatLogSegment::read(uint64_t offset, ChatLogEntry& entry) const {
+    if (offset < sizeof(SegmentHeader) || offset + sizeof(RecordHeader) > size_) {
+        return false;
+    }
+    RecordHeader header;
+    std::memcpy(&header, data_ + offset, sizeof(header));
+    const size_t recordSize = LENGTH_FIELD_SIZE + header.length;
+    if (recordSize != ChatLogFormat::recordSize(header.senderLength, header.targetLength, header.textLength) ||
+        offset + recordSize > size_) {
+        return false;
+    }
+    const char* record = data_ + offset;
+    if (checksum(record + CHECKSUMMED_OFFSET, recordSize - CHECKSUMMED_OFFSET) != header.checksum) {
+        return false;
+    }
+    const char* field = record + sizeof(RecordHeader);
+    entry.offset = offset;
+    entry.size = static_cast<uint32_t>(recordSize);
+    entry.timestampMicros = header.timestampMicros;
+    entry.type = header.type;
+    entry.sender = std::string_view(field, header.senderLength);
+    entry.target = std::string_view(field + header.senderLength, header.targetLength);
+    entry.text = std::string_view(field + header.senderLength + header.targetLength, header.textLength);
+    return true;
+}
+
+const std::string& ChatLogSegment::getPath() const {
+    return path_;
+}
+
+size_t ChatLogSegment::getSize() const {
+    return size_;
+}
+
+std::string ChatLogSegment::pathFor(const std::string& directory, uint64_t sequence) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%08llu%s", SEGMENT_PREFIX, static_cast<unsigned long long>(sequence), SEGMENT_SUFFIX);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+std::vector<std::pair<uint64_t, std::string>> ChatLogSegment::list(const std::string& directory) {
+    std::vector<std::pair<uint64_t, std::string>> segments;
+    const std::string_view prefix(SEGMENT_PREFIX);
+    const std::string_view suffix(SEGMENT_SUFFIX);
+    for (const auto& file : std::filesystem::directory_iterator(directory)) {
+        const std::string name = file.path().filename().string();
+        if (name.size() <= prefix.size() + suffix.size() || !name.starts_with(prefix) || !name.ends_with(suffix)) {
+            continue;
+        }
+        const std::string_view digits(name.data() + prefix.size(), name.size() - prefix.size() - suffix.size());
+        if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        segments.emplace_back(std::stoull(std::string(digits)), file.path().string());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
\ No newline at end of file
@@ -1,12 +1,28 @@
 #include "Client.h"
+#include "Reactor.h"
+#include "LatencyMetrics.h"
+#include <algorithm>
+#include <optional>
 
 Client::Client(int socket)
     : socket_(socket), nickname_("guest" + std::to_string(socket)) {}
 
+std::shared_ptr<Client> Client::create(int socket) {
+    return std::allocate_shared<Client>(PoolAllocator<Client>(), socket);
+}
+
 int Client::getSocket() const {
     return socket_;
 }
 
+ClientId Client::getId() const {
+    return id_;
+}
+
+void Client::setId(ClientId id) {
+    id_ = id;
+}
+
 const std::string& Client::getNickname() const {
     return nickname_;
 }
@@ -15,53 +31,308 @@ void Client::setNickname(const std::string& name) {
     nickname_ = name;
 }
 
-const std::string& Client::getActiveChannel() const {
-    return active_channel_;
+ChannelId Client::getActiveChannel() const {
+    return active_channel_.load(std::memory_order_relaxed);
+}
+
+void Client::setActiveChannel(ChannelId channel) {
+    active_channel_.store(channel, std::memory_order_relaxed);
+}
+
+void Client::joinChannel(ChannelId channel) {
+    if (channel >= MAX_CHANNEL_IDS) return;
+    joined_channels_[channel / CHANNEL_WORD_BITS].fetch_or(uint64_t{1} << (channel % CHANNEL_WORD_BITS), std::memory_order_release);
 }
 
-void Client::setActiveChannel(const std::string& channelName) {
-    active_channel_ = channelName;
+void Client::leaveChannel(ChannelId channel) {
+    if (channel >= MAX_CHANNEL_IDS) return;
+    joined_channels_[channel / CHANNEL_WORD_BITS].fetch_and(~(uint64_t{1} << (channel % CHANNEL_WORD_BITS)), std::memory_order_release);
+    ChannelId active = channel;
+    active_channel_.compare_exchange_strong(active, INVALID_CHANNEL_ID, std::memory_order_relaxed);
 }
 
-void Client::joinChannel(const std::string& channelName) {
-    joined_channels_.insert(channelName);
+bool Client::isInChannel(ChannelId channel) const {
+    if (channel >= MAX_CHANNEL_IDS) return false;
+    const uint64_t word = joined_channels_[channel / CHANNEL_WORD_BITS].load(std::memory_order_acquire);
+    return (word >> (channel % CHANNEL_WORD_BITS)) & 1;
 }
 
-void Client::leaveChannel(const std::string& channelName) {
-    joined_channels_.erase(channelName);
-    if (active_channel_ == channelName) {
-        active_channel_.clear();
+std::vector<ChannelId> Client::getJoinedChannels() const {
+    std::vector<ChannelId> channels;
+    for (size_t i = 0; i < joined_channels_.size(); ++i) {
+        uint64_t word = joined_channels_[i].load(std::memory_order_acquire);
+        while (word != 0) {
+            const auto bit = static_cast<ChannelId>(__builtin_ctzll(word));
+            channels.push_back(static_cast<ChannelId>(i * CHANNEL_WORD_BITS) + bit);
+            word &= word - 1;
+        }
+    }
+    return channels;
+}
+
+LineBuffer& Client::getInputBuffer() {
+    return inputBuffer_;
+}
+
+void Client::pushMessageToQueue(PayloadRef message, MessageKind kind) {
+    if (reactor_ && !reactor_->isInLoopThread()) {
+        reactor_->post({this}, shared_from_this(), std::move(message), kind);
+        return;
+    }
+    if (congested_ && kind == MessageKind::Broadcast && outputPolicy_->policy == SlowConsumerPolicy::DropNonPrivate) {
+        recordDrop(message->size());
+        return;
+    }
+    adjustQueuedBytes(static_cast<int64_t>(message->size()));
+    if (kind == MessageKind::Broadcast) {
+        broadcastBytes_ += message->size();
+    }
+    output_queue_.push_back({std::move(message), kind});
+    if (outputPolicy_ && queuedBytes_ > outputPolicy_->highWatermark) {
+        handleCongestion();
+    }
+    if (reactor_ && !flushScheduled_) {
+        flushScheduled_ = true;
+        reactor_->scheduleFlush(shared_from_this());
     }
 }
 
-const std::unordered_set<std::string>& Client::getJoinedChannels() const {
-    return joined_channels_;
+void Client::pushMessagesToQueue(const PayloadRef* messages, size_t count, MessageKind kind) {
+    if (count == 0) return;
+    if (reactor_ && !reactor_->isInLoopThread()) {
+        for (size_t i = 0; i < count; ++i) {
+            reactor_->post({this}, shared_from_this(), messages[i], kind);
+        }
+        return;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += messages[i]->size();
+    }
+    if (congested_ && kind == MessageKind::Broadcast && outputPolicy_->policy == SlowConsumerPolicy::DropNonPrivate) {
+        for (size_t i = 0; i < count; ++i) {
+            recordDrop(messages[i]->size());
+        }
+        return;
+    }
+    adjustQueuedBytes(static_cast<int64_t>(bytes));
+    if (kind == MessageKind::Broadcast) {
+        broadcastBytes_ += bytes;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        output_queue_.push_back({messages[i], kind});
+    }
+    if (outputPolicy_ && queuedBytes_ > outputPolicy_->highWatermark) {
+        handleCongestion();
+    }
+    if (reactor_ && !flushScheduled_) {
+        flushScheduled_ = true;
+        reactor_->scheduleFlush(shared_from_this());
+    }
 }
 
-void Client::appendToBuffer(const char* data, size_t length) {
-    readBuffer_.append(data, length);
+void Client::handleCongestion() {
+    if (!congested_) {
+        congested_ = true;
+        congestedSince_ = std::chrono::steady_clock::now();
+        if (outputPolicy_->policy == SlowConsumerPolicy::Disconnect && reactor_) {
+            // A client that stops reading may never be pushed to again, so the reactor
+            // enforces the deadline from its timer.
+            reactor_->watchCongestion(shared_from_this());
+        }
+    }
+    switch (outputPolicy_->policy) {
+        case SlowConsumerPolicy::DropOldest:
+            dropOldestOutput();
+            break;
+        case SlowConsumerPolicy::DropNonPrivate:
+            dropBroadcastOutput();
+            break;
+        case SlowConsumerPolicy::Disconnect:
+            checkCongestionDeadline(std::chrono::steady_clock::now());
+            break;
+    }
 }
 
-std::string& Client::getReadBuffer() {
-    return readBuffer_;
+bool Client::checkCongestionDeadline(std::chrono::steady_clock::time_point now) {
+    if (!congested_ || disconnectRequested_ || !reactor_) {
+        return false;
+    }
+    if (now - congestedSince_ < outputPolicy_->disconnectAfter) {
+        return true;
+    }
+    disconnectRequested_ = true;
+    outputPolicy_->slowConsumerDisconnects++;
+    reactor_->requestDisconnect(shared_from_this());
+    return false;
 }
 
-void Client::pushMessageToQueue(const std::string& message) {
-    std::lock_guard<std::mutex> lock(output_mutex_);
-    output_queue_.push(message);
+void Client::dropOldestOutput() {
+    // The head may be partially written; cutting it would corrupt the stream.
+    std::optional<QueuedMessage> head;
+    if (outputOffset_ > 0 && !output_queue_.empty()) {
+        head = std::move(output_queue_.front());
+        output_queue_.pop_front();
+    }
+    while (!output_queue_.empty() && queuedBytes_ > outputPolicy_->lowWatermark) {
+        const QueuedMessage& message = output_queue_.front();
+        adjustQueuedBytes(-static_cast<int64_t>(message.payload->size()));
+        if (message.kind == MessageKind::Broadcast) {
+            broadcastBytes_ -= message.payload->size();
+        }
+        recordDrop(message.payload->size());
+        output_queue_.pop_front();
+    }
+    if (head) {
+        output_queue_.push_front(std::move(*head));
+    }
 }
 
-std::string Client::getNextMessageFromQueue() {
-    std::lock_guard<std::mutex> lock(output_mutex_);
-    if (output_queue_.empty()) {
-        return "";
+void Client::dropBroadcastOutput() {
+    size_t droppable = broadcastBytes_;
+    const bool keepHead = outputOffset_ > 0 && !output_queue_.empty();
+    if (keepHead && output_queue_.front().kind == MessageKind::Broadcast) {
+        droppable -= output_queue_.front().payload->size();
+    }
+    // Broadcasts are refused while congested, so once they are gone every further push
+    // lands here with nothing to free.
+    if (droppable == 0) {
+        return;
     }
-    return output_queue_.front();
+    auto kept = output_queue_.begin() + (keepHead ? 1 : 0);
+    for (auto it = kept; it != output_queue_.end(); ++it) {
+        if (it->kind == MessageKind::Broadcast && queuedBytes_ > outputPolicy_->lowWatermark) {
+            adjustQueuedBytes(-static_cast<int64_t>(it->payload->size()));
+            broadcastBytes_ -= it->payload->size();
+            recordDrop(it->payload->size());
+            continue;
+        }
+        if (kept != it) {
+            *kept = std::move(*it);
+        }
+        ++kept;
+    }
+    output_queue_.erase(kept, output_queue_.end());
 }
 
-void Client::popMessageFromQueue() {
-    std::lock_guard<std::mutex> lock(output_mutex_);
-    if (!output_queue_.empty()) {
-        output_queue_.pop();
+void Client::adjustQueuedBytes(int64_t delta) {
+    queuedBytes_.store(static_cast<size_t>(static_cast<int64_t>(queuedBytes_.load(std::memory_order_relaxed)) + delta), std::memory_order_relaxed);
+    if (shardStats_) {
+        ShardStats::add(shardStats_->queuedBytes, delta);
     }
+}
+
+void Client::recordDrop(size_t bytes) {
+    outputPolicy_->droppedBytes += bytes;
+    outputPolicy_->droppedMessages++;
+}
+
+size_t Client::getQueuedMessageCount() const {
+    return output_queue_.size();
+}
+
+size_t Client::getQueuedBytes() const {
+    return queuedBytes_.load(std::memory_order_relaxed);
+}
+
+bool Client::hasPendingOutput() const {
+    return !output_queue_.empty();
+}
+
+size_t Client::gatherOutput(iovec* iov, size_t maxEntries, size_t* totalBytes) const {
+    size_t count = 0;
+    size_t bytes = 0;
+    size_t offset = outputOffset_;
+    for (auto it = output_queue_.begin(); it != output_queue_.end() && count < maxEntries; ++it) {
+        const PayloadRef& message = it->payload;
+        iov[count].iov_base = const_cast<char*>(message->data() + offset);
+        iov[count].iov_len = message->size() - offset;
+        bytes += iov[count].iov_len;
+        offset = 0;
+        count++;
+    }
+    if (totalBytes) {
+        *totalBytes = bytes;
+    }
+    return count;
+}
+
+void Client::consumeOutput(size_t bytes) {
+    bytes = std::min(bytes, queuedBytes_.load(std::memory_order_relaxed));
+    adjustQueuedBytes(-static_cast<int64_t>(bytes));
+    if (shardStats_) {
+        ShardStats::add<uint64_t>(shardStats_->bytesWritten, bytes);
+        ShardStats::add<uint64_t>(shardStats_->writeCalls, 1);
+    }
+    uint64_t writtenAt = 0;
+    while (bytes > 0 && !output_queue_.empty()) {
+        const PayloadRef& head = output_queue_.front().payload;
+        const size_t remaining = head->size() - outputOffset_;
+        if (bytes < remaining) {
+            outputOffset_ += bytes;
+            break;
+        }
+        if (writtenAt == 0) {
+            writtenAt = LatencyMetrics::now();
+        }
+        LatencyMetrics::global().recordStage(LatencyStage::EnqueuedToWritten, writtenAt - head->getCreatedAt());
+        bytes -= remaining;
+        outputOffset_ = 0;
+        if (output_queue_.front().kind == MessageKind::Broadcast) {
+            broadcastBytes_ -= head->size();
+        }
+        output_queue_.pop_front();
+    }
+    if (congested_ && queuedBytes_ <= outputPolicy_->lowWatermark) {
+        congested_ = false;
+    }
+}
+
+std::string Client::takePendingOutput() {
+    std::string output;
+    output.reserve(queuedBytes_.load(std::memory_order_relaxed));
+    size_t offset = outputOffset_;
+    for (const auto& message : output_queue_) {
+        output.append(message.payload->data() + offset, message.payload->size() - offset);
+        offset = 0;
+    }
+    adjustQueuedBytes(-static_cast<int64_t>(queuedBytes_.load(std::memory_order_relaxed)));
+    output_queue_.clear();
+    outputOffset_ = 0;
+    broadcastBytes_ = 0;
+    congested_ = false;
+    return output;
+}
+
+bool Client::isWriteBlocked() const {
+    return writeBlocked_;
+}
+
+void Client::setWriteBlocked(bool blocked) {
+    writeBlocked_ = blocked;
+}
+
+Reactor* Client::getReactor() const {
+    return reactor_;
+}
+
+uint64_t Client::getConnectionId() const {
+    return connectionId_;
+}
+
+void Client::setReactor(Reactor* reactor, uint64_t connectionId) {
+    reactor_ = reactor;
+    connectionId_ = connectionId;
+}
+
+void Client::setOutputPolicy(OutputPolicy* policy) {
+    outputPolicy_ = policy;
+}
+
+void Client::setShardStats(ShardStats* stats) {
+    shardStats_ = stats;
+}
+
+void Client::clearFlushScheduled() {
+    flushScheduled_ = false;
 }
\ No newline at end of file
@@ -1,61 +1,169 @@
 #include "ClientManager.h"
+#include "Reactor.h"
 #include <iostream>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <algorithm>
 
 ClientManager::ClientManager(int maxClients)
-    : maxClients_(maxClients), totalConnections_(0) {}
+    : maxClients_(maxClients), slots_(std::make_unique<Slot[]>(maxClients)), totalConnections_(0) {
+    freeSlots_.reserve(maxClients);
+    for (int i = maxClients - 1; i >= 0; --i) {
+        freeSlots_.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+ClientManager::NicknameShard& ClientManager::nicknameShardFor(std::string_view nickname) {
+    return nicknames_[NicknameHash{}(nickname) % NICKNAME_SHARD_COUNT];
+}
+
+const ClientManager::NicknameShard& ClientManager::nicknameShardFor(std::string_view nickname) const {
+    return nicknames_[NicknameHash{}(nickname) % NICKNAME_SHARD_COUNT];
+}
+
+void ClientManager::eraseNickname(const std::string& nickname, const std::shared_ptr<Client>& client) {
+    NicknameShard& shard = nicknameShardFor(nickname);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.clients.find(nickname);
+    if (it != shard.clients.end() && it->second == client) {
+        shard.clients.erase(it);
+    }
+}
 
 bool ClientManager::addClient(std::shared_ptr<Client> client) {
     if (!client) return false;
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    if (clients_.size() >= static_cast<size_t>(maxClients_)) {
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        if (freeSlots_.empty() || clientExists(client->getId())) {
+            return false;
+        }
+        const uint32_t index = freeSlots_.back();
+        freeSlots_.pop_back();
+        Slot& slot = slots_[index];
+        slot.client = client;
+        client->setId({index, slot.generation.load(std::memory_order_relaxed) + 1});
+        slot.generation.fetch_add(1, std::memory_order_release);
+        clientCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        NicknameShard& shard = nicknameShardFor(client->getNickname());
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.clients[client->getNickname()] = client;
     }
-    auto [it, success] = clients_.insert(client);
-    if (success) {
-        nicknameToClient_[client->getNickname()] = client;
-        if (onClientAddedCallback_) {
-            onClientAddedCallback_(client);
+    if (onClientAddedCallback_) {
+        onClientAddedCallback_(client);
+    }
+    return true;
+}
+
+size_t ClientManager::restoreClients(const std::vector<std::shared_ptr<Client>>& clients) {
+    size_t added = 0;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        for (; added < clients.size() && !freeSlots_.empty(); ++added) {
+            const uint32_t index = freeSlots_.back();
+            freeSlots_.pop_back();
+            Slot& slot = slots_[index];
+            slot.client = clients[added];
+            clients[added]->setId({index, slot.generation.load(std::memory_order_relaxed) + 1});
+            slot.generation.fetch_add(1, std::memory_order_release);
+        }
+        clientCount_.fetch_add(added, std::memory_order_relaxed);
+    }
+    std::array<std::vector<size_t>, NICKNAME_SHARD_COUNT> byShard;
+    for (size_t i = 0; i < added; ++i) {
+        byShard[&nicknameShardFor(clients[i]->getNickname()) - nicknames_.data()].push_back(i);
+    }
+    for (size_t shard = 0; shard < NICKNAME_SHARD_COUNT; ++shard) {
+        if (byShard[shard].empty()) continue;
+        std::unique_lock<std::shared_mutex> lock(nicknames_[shard].mutex);
+        for (size_t i : byShard[shard]) {
+            nicknames_[shard].clients[clients[i]->getNickname()] = clients[i];
         }
     }
-    return success;
+    if (onClientAddedCallback_) {
+        for (size_t i = 0; i < added; ++i) {
+            onClientAddedCallback_(clients[i]);
+        }
+    }
+    return added;
 }
 
-bool ClientManager::removeClient(std::shared_ptr<Client> client) {
-    if (!client) return false;
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    auto it = clients_.find(client);
-    if (it != clients_.end()) {
-        int socket = client->getSocket();
-        shutdown(socket, SHUT_RDWR);
-        close(socket);
-        nicknameToClient_.erase(client->getNickname());
-        clients_.erase(it);
-        if (onClientRemovedCallback_) {
-            onClientRemovedCallback_(client);
+size_t ClientManager::closeAllClients() {
+    size_t closed = 0;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        for (int i = 0; i < maxClients_; ++i) {
+            Slot& slot = slots_[i];
+            uint32_t generation = slot.generation.load(std::memory_order_acquire);
+            // A concurrent removeClient() that already claimed the slot finishes it itself.
+            if (!slot.client || (generation & 1) == 0 ||
+                !slot.generation.compare_exchange_strong(generation, generation + 1, std::memory_order_acq_rel)) {
+                continue;
+            }
+            shutdown(slot.client->getSocket(), SHUT_RDWR);
+            close(slot.client->getSocket());
+            slot.client.reset();
+            freeSlots_.push_back(static_cast<uint32_t>(i));
+            closed++;
         }
-        return true;
+        clientCount_.fetch_sub(closed, std::memory_order_relaxed);
+    }
+    for (auto& shard : nicknames_) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.clients.clear();
     }
-    return false;
+    return closed;
 }
 
-bool ClientManager::clientExists(std::shared_ptr<Client> client) const {
+bool ClientManager::removeClient(std::shared_ptr<Client> client) {
     if (!client) return false;
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    return clients_.find(client) != clients_.end();
+    const ClientId id = client->getId();
+    if (id.index >= static_cast<uint32_t>(maxClients_)) {
+        return false;
+    }
+    // Whoever moves the generation off the client's value owns the teardown.
+    uint32_t expected = id.generation;
+    if (!slots_[id.index].generation.compare_exchange_strong(expected, id.generation + 1, std::memory_order_acq_rel)) {
+        return false;
+    }
+    int socket = client->getSocket();
+    shutdown(socket, SHUT_RDWR);
+    close(socket);
+    eraseNickname(client->getNickname(), client);
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        slots_[id.index].client.reset();
+        freeSlots_.push_back(id.index);
+        clientCount_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    if (onClientRemovedCallback_) {
+        onClientRemovedCallback_(client);
+    }
+    return true;
 }
 
-bool ClientManager::clientExistsByNickname(const std::string& nickname) const {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    return nicknameToClient_.find(nickname) != nicknameToClient_.end();
+bool ClientManager::clientExists(ClientId id) const {
+    return id.index < static_cast<uint32_t>(maxClients_) &&
+           slots_[id.index].generation.load(std::memory_order_acquire) == id.generation;
 }
 
-std::shared_ptr<Client> ClientManager::getClientByNickname(const std::string& nickname) {
+std::shared_ptr<Client> ClientManager::getClient(ClientId id) const {
     std::lock_guard<std::mutex> lock(clients_mutex_);
-    auto it = nicknameToClient_.find(nickname);
-    if (it != nicknameToClient_.end()) {
+    return clientExists(id) ? slots_[id.index].client : nullptr;
+}
+
+bool ClientManager::clientExistsByNickname(std::string_view nickname) const {
+    const NicknameShard& shard = nicknameShardFor(nickname);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.clients.find(nickname) != shard.clients.end();
+}
+
+std::shared_ptr<Client> ClientManager::getClientByNickname(std::string_view nickname) {
+    const NicknameShard& shard = nicknameShardFor(nickname);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.clients.find(nickname);
+    if (it != shard.clients.end()) {
         return it->second;
     }
     return nullptr;
@@ -64,40 +172,48 @@ std::shared_ptr<Client> ClientManager::getClientByNickname(const std::string& ni
 std::vector<std::shared_ptr<Client>> ClientManager::getAllClients() const {
     std::lock_guard<std::mutex> lock(clients_mutex_);
     std::vector<std::shared_ptr<Client>> clientList;
-    clientList.reserve(clients_.size());
-    for (const auto& client : clients_) {
-        clientList.push_back(client);
+    clientList.reserve(clientCount_.load(std::memory_order_relaxed));
+    for (int i = 0; i < maxClients_; ++i) {
+        if (slots_[i].client) {
+            clientList.push_back(slots_[i].client);
+        }
     }
     return clientList;
 }
 
 void ClientManager::broadcastMessage(const std::string& message, std::shared_ptr<Client> sender) {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    std::string formatted_message;
+    PayloadRef formatted_message;
     if (sender) {
-        formatted_message = "<" + sender->getNickname() + "> " + message;
+        formatted_message = MessagePayload::concat({"<", sender->getNickname(), "> ", message, "\n"});
     } else {
-        formatted_message = message;
+        formatted_message = MessagePayload::concat({message, "\n"});
     }
-    for (const auto& client : clients_) {
+    auto recipients = std::make_shared<std::vector<std::shared_ptr<Client>>>(getAllClients());
+    DeliveryBatch batch(std::move(formatted_message), recipients);
+    for (const auto& client : *recipients) {
         if (client != sender) {
-            client->pushMessageToQueue(formatted_message + "\n");
+            batch.add(client.get());
         }
     }
+    batch.dispatch();
 }
 
 void ClientManager::sendMessageToClient(std::shared_ptr<Client> client, const std::string& message) {
     if (!client) return;
-    std::string formatted_message = message;
-    if (formatted_message.back() != '\n') {
-        formatted_message += "\n";
+    if (!message.empty() && message.back() == '\n') {
+        client->pushMessageToQueue(MessagePayload::create(message));
+    } else {
+        client->pushMessageToQueue(MessagePayload::concat({message, "\n"}));
     }
-    client->pushMessageToQueue(formatted_message);
+}
+
+void ClientManager::sendMessageToClient(const std::shared_ptr<Client>& client, PayloadRef message) {
+    if (!client) return;
+    client->pushMessageToQueue(std::move(message));
 }
 
 size_t ClientManager::getClientCount() const {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    return clients_.size();
+    return clientCount_.load(std::memory_order_relaxed);
 }
 
 size_t ClientManager::getTotalConnectionsCount() const {
@@ -113,8 +229,7 @@ int ClientManager::getMaxClients() const {
 }
 
 bool ClientManager::canAcceptNewConnection() const {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    return clients_.size() < static_cast<size_t>(maxClients_);
+    return clientCount_.load(std::memory_order_relaxed) < static_cast<size_t>(maxClients_);
 }
 
 void ClientManager::setOnClientAddedCallback(std::function<void(std::shared_ptr<Client>)> callback) {
@@ -137,13 +252,15 @@ bool ClientManager::updateClientNickname(std::shared_ptr<Client> client, const s
     if (!client || !isValidNickname(newNickname)) {
         return false;
     }
-    std::lock_guard<std::mutex> lock(clients_mutex_);
-    if (nicknameToClient_.find(newNickname) != nicknameToClient_.end()) {
-        return false;
+    {
+        NicknameShard& shard = nicknameShardFor(newNickname);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        if (!shard.clients.try_emplace(newNickname, client).second) {
+            return false;
+        }
     }
-    nicknameToClient_.erase(client->getNickname());
     std::string oldNickname = client->getNickname();
     client->setNickname(newNickname);
-    nicknameToClient_[newNickname] = client;
+    eraseNickname(oldNickname, client);
     return true;
 }
\ No newline at end of file
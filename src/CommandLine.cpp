@@ -0,0 +1,66 @@
+#include "CommandLine.h"
+
+CommandLine::CommandLine(std::string_view line) : line_(line) {
+    size_t position = skipSpaces(line_, 0);
+    if (position < line_.size() && line_[position] == '/') {
+        position++;
+    }
+    const size_t nameStart = position;
+    while (position < line_.size() && !isSpace(line_[position])) {
+        position++;
+    }
+    name_ = line_.substr(nameStart, position - nameStart);
+    argsStart_ = position;
+
+    position = skipSpaces(line_, position);
+    while (position < line_.size() && argCount_ < MAX_ARGS) {
+        const size_t start = position;
+        while (position < line_.size() && !isSpace(line_[position])) {
+            position++;
+        }
+        args_[argCount_++] = line_.substr(start, position - start);
+        position = skipSpaces(line_, position);
+    }
+}
+
+std::string_view CommandLine::getName() const {
+    return name_;
+}
+
+size_t CommandLine::getArgCount() const {
+    return argCount_;
+}
+
+bool CommandLine::hasArgs() const {
+    return argCount_ > 0;
+}
+
+std::string_view CommandLine::getArg(size_t index) const {
+    return index < argCount_ ? args_[index] : std::string_view();
+}
+
+std::string_view CommandLine::getTrailing(size_t index) const {
+    size_t position = skipSpaces(line_, argsStart_);
+    for (size_t i = 0; i < index && position < line_.size(); ++i) {
+        while (position < line_.size() && !isSpace(line_[position])) {
+            position++;
+        }
+        position = skipSpaces(line_, position);
+    }
+    std::string_view trailing = line_.substr(position);
+    while (!trailing.empty() && isSpace(trailing.back())) {
+        trailing.remove_suffix(1);
+    }
+    return trailing;
+}
+
+bool CommandLine::isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+size_t CommandLine::skipSpaces(std::string_view text, size_t position) {
+    while (position < text.size() && isSpace(text[position])) {
+        position++;
+    }
+    return position;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "HistoryService.h"
+#include <ctime>
+#include <cstdio>
+#include <future>
+
+HistoryService::HistoryService(std::string directory, bool tokenIndex, std::chrono::milliseconds refreshInterval)
+    : index_(std::move(directory), tokenIndex), refreshInterval_(refreshInterval) {}
+
+HistoryService::~HistoryService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void HistoryService::start() {
+    thread_ = std::thread([this] { run(); });
+}
+
+void HistoryService::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    wakeup_.notify_one();
+}
+
+void HistoryService::run() {
+    auto nextRefresh = std::chrono::steady_clock::now();
+    while (true) {
+        std::vector<std::function<void()>> jobs;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            const auto until = streams_.empty() ? nextRefresh : std::min(nextRefresh, std::chrono::steady_clock::now() + STREAM_POLL_INTERVAL);
+            wakeup_.wait_until(lock, until, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            jobs.swap(jobs_);
+        }
+        // Every query sees the log up to the moment it runs.
+        if (!jobs.empty() || std::chrono::steady_clock::now() >= nextRefresh) {
+            index_.refresh();
+            publishCounters();
+            nextRefresh = std::chrono::steady_clock::now() + refreshInterval_;
+        }
+        for (auto& job : jobs) {
+            job();
+        }
+        pumpStreams();
+    }
+}
+
+void HistoryService::requestChannelHistory(std::shared_ptr<Client> client, std::string channel, uint64_t sinceMicros, size_t limit) {
+    limit = std::min(limit, MAX_HISTORY_LIMIT);
+    submit([this, client = std::move(client), channel = std::move(channel), sinceMicros, limit]() mutable {
+        std::vector<PayloadRef> batches;
+        std::string batch;
+        size_t linesInBatch = 0;
+        const size_t found = index_.findChannelMessages(channel, sinceMicros, limit, [&](const ChatLogEntry& entry) {
+            if (linesInBatch == 0 && batches.empty()) {
+                batch = "*** History of " + channel + ":\n";
+            }
+            batch += formatEntry(entry);
+            if (++linesInBatch == STREAM_BATCH_LINES) {
+                batches.push_back(MessagePayload::create(batch));
+                batch.clear();
+                linesInBatch = 0;
+            }
+        });
+        batch += found == 0 ? "*** No history for " + channel + ".\n" : "*** End of history (" + std::to_string(found) + " lines).\n";
+        batches.push_back(MessagePayload::create(batch));
+        streams_.push_back({std::move(client), std::move(batches), 0, 0, 0, std::chrono::steady_clock::now() + STREAM_TIMEOUT});
+    });
+}
+
+std::string HistoryService::grep(std::string query, std::string channel, size_t limit) {
+    limit = std::min(limit, MAX_GREP_LIMIT);
+    auto result = std::make_shared<std::promise<std::string>>();
+    auto future = result->get_future();
+    submit([this, result, query = std::move(query), channel = std::move(channel), limit] {
+        std::string out;
+        index_.grep(query, channel, limit, [&](const ChatLogEntry& entry) { out += formatEntry(entry); });
+        result->set_value(std::move(out));
+    });
+    return future.get();
+}
+
+void HistoryService::pumpStreams() {
+    const auto now = std::chrono::steady_clock::now();
+    std::erase_if(streams_, [now](Stream& stream) {
+        // A batch is written (or dropped) once the stream holds its last reference.
+        while (stream.released < stream.next && stream.batches[stream.released].isUnique()) {
+            stream.inFlightBytes -= stream.batches[stream.released]->size();
+            stream.batches[stream.released++].reset();
+        }
+        if (stream.inFlightBytes < STREAM_PAUSE_BYTES && stream.client->getQueuedBytes() < STREAM_PAUSE_BYTES) {
+            stream.inFlightBytes += stream.batches[stream.next]->size();
+            stream.client->pushMessageToQueue(stream.batches[stream.next++]);
+        }
+        // A client that stops reading (or has disconnected) gets the rest dropped.
+        return stream.next == stream.batches.size() || now >= stream.deadline;
+    });
+}
+
+void HistoryService::publishCounters() {
+    indexedRecords_.store(index_.getIndexedRecords(), std::memory_order_relaxed);
+    indexMemoryUsage_.store(index_.getMemoryUsage(), std::memory_order_relaxed);
+}
+
+size_t HistoryService::getIndexedRecords() const {
+    return indexedRecords_.load(std::memory_order_relaxed);
+}
+
+size_t HistoryService::getIndexMemoryUsage() const {
+    return indexMemoryUsage_.load(std::memory_order_relaxed);
+}
+
+std::string HistoryService::formatEntry(const ChatLogEntry& entry) {
+    const std::time_t seconds = static_cast<std::time_t>(entry.timestampMicros / 1000000);
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+    char time[32];
+    std::strftime(time, sizeof(time), "[%Y-%m-%d %H:%M:%S] ", &utc);
+    std::string line(time);
+    if (entry.type == ChatLogFormat::RecordType::Channel) {
+        line.append("<").append(entry.sender).append("@").append(entry.target).append("> ");
+    } else {
+        line.append("*").append(entry.sender).append(" -> ").append(entry.target).append("* ");
+    }
+    line.append(entry.text).append("\n");
+    return line;
+}
\ No newline at end of file
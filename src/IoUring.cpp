@@ -0,0 +1,195 @@
+#include "IoUring.h"
+#include <system_error>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+    int sysIoUringSetup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+    }
+
+    int sysIoUringRegister(int fd, unsigned opcode, void* arg, unsigned argCount) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, argCount));
+    }
+
+    template <typename T>
+    T loadAcquire(T* location) {
+        return std::atomic_ref<T>(*location).load(std::memory_order_acquire);
+    }
+
+    template <typename T>
+    void storeRelease(T* location, T value) {
+        std::atomic_ref<T>(*location).store(value, std::memory_order_release);
+    }
+}
+
+IoUring::IoUring(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    ringFd_ = sysIoUringSetup(entries, &params);
+    if (ringFd_ < 0 && errno == EINVAL) {
+        params = io_uring_params{};
+        ringFd_ = sysIoUringSetup(entries, &params);
+    }
+    if (ringFd_ < 0) {
+        throw std::system_error(errno, std::system_category(), "io_uring_setup failed");
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        close(ringFd_);
+        throw std::system_error(ENOSYS, std::system_category(), "io_uring kernel support too old");
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (cqRingSize_ > sqRingSize_) {
+        sqRingSize_ = cqRingSize_;
+    }
+    cqRingSize_ = sqRingSize_;
+    sqRingPtr_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if (sqRingPtr_ == MAP_FAILED) {
+        close(ringFd_);
+        throw std::system_error(errno, std::system_category(), "Failed to map io_uring rings");
+    }
+    cqRingPtr_ = sqRingPtr_;
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(sqRingPtr_, sqRingSize_);
+        close(ringFd_);
+        throw std::system_error(errno, std::system_category(), "Failed to map io_uring SQEs");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<char*>(sqRingPtr_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqLocalTail_ = *sqTail_;
+    sqSubmitted_ = sqLocalTail_;
+
+    auto* cq = static_cast<char*>(cqRingPtr_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+}
+
+IoUring::~IoUring() {
+    if (buffers_) munmap(buffers_, buffersSize_);
+    if (bufferRing_) munmap(bufferRing_, bufferRingSize_);
+    munmap(sqes_, sqesSize_);
+    munmap(sqRingPtr_, sqRingSize_);
+    close(ringFd_);
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    if (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_) {
+        submitAndWait(0);
+        if (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_) {
+            return nullptr;
+        }
+    }
+    const unsigned index = sqLocalTail_ & sqMask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqArray_[index] = index;
+    sqLocalTail_++;
+    storeRelease(sqTail_, sqLocalTail_);
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned waitCount) {
+    const unsigned toSubmit = sqLocalTail_ - sqSubmitted_;
+    if (toSubmit == 0 && waitCount == 0) {
+        return 0;
+    }
+    const int result = sysIoUringEnter(ringFd_, toSubmit, waitCount, waitCount > 0 ? IORING_ENTER_GETEVENTS : 0);
+    if (result < 0) {
+        return -errno;
+    }
+    sqSubmitted_ += static_cast<unsigned>(result);
+    return result;
+}
+
+bool IoUring::supportsOpcodes(std::initializer_list<uint8_t> opcodes) const {
+    constexpr unsigned PROBE_OPS = 256;
+    std::vector<char> storage(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (sysIoUringRegister(ringFd_, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+        return false;
+    }
+    for (uint8_t opcode : opcodes) {
+        if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+io_uring_cqe* IoUring::peekCqe() {
+    const unsigned head = *cqHead_;
+    if (head == loadAcquire(cqTail_)) {
+        return nullptr;
+    }
+    return &cqes_[head & cqMask_];
+}
+
+void IoUring::advanceCq(unsigned count) {
+    storeRelease(cqHead_, *cqHead_ + count);
+}
+
+void IoUring::registerBufferRing(uint16_t groupId, unsigned entries, size_t bufferSize) {
+    bufferRingSize_ = entries * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, bufferRingSize_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), "Failed to allocate buffer ring");
+    }
+    bufferRing_ = static_cast<io_uring_buf*>(ring);
+    buffersSize_ = entries * bufferSize;
+    void* buffers = mmap(nullptr, buffersSize_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (buffers == MAP_FAILED) {
+        throw std::system_error(errno, std::system_category(), "Failed to allocate receive buffers");
+    }
+    buffers_ = static_cast<char*>(buffers);
+    bufferSize_ = bufferSize;
+    bufferEntries_ = entries;
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(bufferRing_);
+    registration.ring_entries = entries;
+    registration.bgid = groupId;
+    if (sysIoUringRegister(ringFd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        throw std::system_error(errno, std::system_category(), "Failed to register buffer ring");
+    }
+    for (unsigned i = 0; i < entries; ++i) {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+}
+
+char* IoUring::getBuffer(uint16_t bufferId) const {
+    return buffers_ + static_cast<size_t>(bufferId) * bufferSize_;
+}
+
+void IoUring::recycleBuffer(uint16_t bufferId) {
+    io_uring_buf* buffer = &bufferRing_[bufferTail_ & (bufferEntries_ - 1)];
+    buffer->addr = reinterpret_cast<uint64_t>(getBuffer(bufferId));
+    buffer->len = static_cast<uint32_t>(bufferSize_);
+    buffer->bid = bufferId;
+    bufferTail_++;
+    storeRelease(&bufferRing_[0].resv, bufferTail_);
+}
+
+size_t IoUring::getBufferSize() const {
+    return bufferSize_;
+}
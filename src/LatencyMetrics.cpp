@@ -0,0 +1,135 @@
+#include "LatencyMetrics.h"
+#include <algorithm>
+
+namespace {
+    thread_local void* localBlockPtr = nullptr;
+    thread_local uint64_t lineParsedAt = 0;
+
+    constexpr std::array<const char*, static_cast<size_t>(LatencyStage::Count)> STAGE_NAMES = {
+        "recv_to_parsed", "parsed_to_enqueued", "enqueued_to_written"
+    };
+
+    LatencySummary summarizeSnapshot(std::string name, const LatencyHistogram::Snapshot& snapshot) {
+        constexpr double NANOS_PER_MICRO = 1000.0;
+        return LatencySummary{
+            std::move(name),
+            snapshot.count,
+            snapshot.sum / NANOS_PER_MICRO,
+            snapshot.percentile(0.50) / NANOS_PER_MICRO,
+            snapshot.percentile(0.90) / NANOS_PER_MICRO,
+            snapshot.percentile(0.99) / NANOS_PER_MICRO,
+            snapshot.percentile(0.999) / NANOS_PER_MICRO,
+            snapshot.max / NANOS_PER_MICRO
+        };
+    }
+}
+
+void LatencyHistogram::Snapshot::add(const LatencyHistogram& histogram) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        buckets[i] += histogram.buckets_[i].load(std::memory_order_relaxed);
+    }
+    count += histogram.count_.load(std::memory_order_relaxed);
+    sum += histogram.sum_.load(std::memory_order_relaxed);
+    max = std::max(max, histogram.max_.load(std::memory_order_relaxed));
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<uint64_t>(quantile * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+LatencyMetrics::ThreadBlock::~ThreadBlock() {
+    for (auto& command : commands) {
+        delete command.load(std::memory_order_relaxed);
+    }
+}
+
+LatencyMetrics& LatencyMetrics::global() {
+    static LatencyMetrics metrics;
+    return metrics;
+}
+
+LatencyMetrics::ThreadBlock& LatencyMetrics::localBlock() {
+    if (!localBlockPtr) {
+        auto block = std::make_unique<ThreadBlock>();
+        localBlockPtr = block.get();
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.push_back(std::move(block));
+    }
+    return *static_cast<ThreadBlock*>(localBlockPtr);
+}
+
+void LatencyMetrics::recordStage(LatencyStage stage, uint64_t nanoseconds) {
+    localBlock().stages[static_cast<size_t>(stage)].record(nanoseconds);
+}
+
+void LatencyMetrics::recordCommand(size_t commandSlot, uint64_t nanoseconds) {
+    if (commandSlot >= MAX_COMMANDS) return;
+    auto& slot = localBlock().commands[commandSlot];
+    LatencyHistogram* histogram = slot.load(std::memory_order_relaxed);
+    if (!histogram) {
+        histogram = new LatencyHistogram();
+        slot.store(histogram, std::memory_order_release);
+    }
+    histogram->record(nanoseconds);
+}
+
+size_t LatencyMetrics::registerCommand(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < commandNames_.size(); ++i) {
+        if (commandNames_[i] == name) return i;
+    }
+    if (commandNames_.size() >= MAX_COMMANDS) {
+        return UNTRACKED_COMMAND;
+    }
+    commandNames_.push_back(name);
+    return commandNames_.size() - 1;
+}
+
+void LatencyMetrics::setLineParsedAt(uint64_t timestamp) {
+    lineParsedAt = timestamp;
+}
+
+uint64_t LatencyMetrics::getLineParsedAt() {
+    return lineParsedAt;
+}
+
+void LatencyMetrics::recordSinceLineParsed(LatencyStage stage) {
+    if (lineParsedAt != 0) {
+        recordStage(stage, now() - lineParsedAt);
+    }
+}
+
+std::vector<LatencySummary> LatencyMetrics::summarize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<LatencySummary> summaries;
+    // Snapshots are large; build them one metric at a time on the heap.
+    auto snapshot = std::make_unique<LatencyHistogram::Snapshot>();
+    for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        *snapshot = {};
+        for (const auto& block : blocks_) {
+            snapshot->add(block->stages[stage]);
+        }
+        summaries.push_back(summarizeSnapshot(STAGE_NAMES[stage], *snapshot));
+    }
+    for (size_t command = 0; command < commandNames_.size(); ++command) {
+        *snapshot = {};
+        for (const auto& block : blocks_) {
+            if (const LatencyHistogram* histogram = block->commands[command].load(std::memory_order_acquire)) {
+                snapshot->add(*histogram);
+            }
+        }
+        summaries.push_back(summarizeSnapshot("command_" + commandNames_[command], *snapshot));
+    }
+    return summaries;
+}
\ No newline at end of file
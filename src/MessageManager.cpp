@@ -1,144 +1,278 @@
 #include "MessageManager.h"
 #include "ClientManager.h"
 #include "ChannelManager.h"
+#include "LatencyMetrics.h"
+#include "ChatLog.h"
+#include "HistoryService.h"
 #include <iostream>
-#include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <charconv>
+#include <chrono>
+#include <optional>
+
+namespace {
+    enum class BuiltinCommand : uint8_t {
+        Nick, Join, Part, Quit, List, Who, Msg, Motd, Help, History, Count
+    };
+
+    constexpr std::array<std::string_view, static_cast<size_t>(BuiltinCommand::Count)> BUILTIN_NAMES = {
+        "nick", "join", "part", "quit", "list", "who", "msg", "motd", "help", "history"
+    };
+
+    // Perfect hash over BUILTIN_NAMES: the seed is searched at compile time so that every
+    // built-in lands in its own slot, and a lookup costs one short hash plus one compare.
+    constexpr size_t BUILTIN_TABLE_SIZE = 32;
+
+    constexpr uint32_t hashCommandName(std::string_view name, uint32_t seed) {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char c : name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    constexpr bool isPerfectSeed(uint32_t seed) {
+        std::array<bool, BUILTIN_TABLE_SIZE> used{};
+        for (std::string_view name : BUILTIN_NAMES) {
+            const size_t slot = hashCommandName(name, seed) % BUILTIN_TABLE_SIZE;
+            if (used[slot]) return false;
+            used[slot] = true;
+        }
+        return true;
+    }
+
+    constexpr uint32_t findPerfectSeed() {
+        uint32_t seed = 0;
+        while (!isPerfectSeed(seed)) {
+            seed++;
+        }
+        return seed;
+    }
+
+    constexpr uint32_t BUILTIN_SEED = findPerfectSeed();
+
+    constexpr std::array<int8_t, BUILTIN_TABLE_SIZE> buildBuiltinTable() {
+        std::array<int8_t, BUILTIN_TABLE_SIZE> table{};
+        for (auto& slot : table) slot = -1;
+        for (size_t i = 0; i < BUILTIN_NAMES.size(); ++i) {
+            table[hashCommandName(BUILTIN_NAMES[i], BUILTIN_SEED) % BUILTIN_TABLE_SIZE] = static_cast<int8_t>(i);
+        }
+        return table;
+    }
+
+    constexpr auto BUILTIN_TABLE = buildBuiltinTable();
+
+    constexpr int findBuiltin(std::string_view name) {
+        const int index = BUILTIN_TABLE[hashCommandName(name, BUILTIN_SEED) % BUILTIN_TABLE_SIZE];
+        return index >= 0 && BUILTIN_NAMES[index] == name ? index : -1;
+    }
+
+    static_assert(findBuiltin("msg") == static_cast<int>(BuiltinCommand::Msg));
+    static_assert(findBuiltin("help") == static_cast<int>(BuiltinCommand::Help));
+    static_assert(findBuiltin("bogus") == -1);
+
+    // "[HH:MM:SS] " in UTC, the prefix of every stored history line.
+    std::string_view formatHistoryTime(char (&buffer)[12]) {
+        const auto secondsOfDay = static_cast<unsigned>(std::time(nullptr) % 86400);
+        const unsigned fields[3] = {secondsOfDay / 3600, secondsOfDay / 60 % 60, secondsOfDay % 60};
+        buffer[0] = '[';
+        for (int i = 0; i < 3; ++i) {
+            buffer[1 + i * 3] = static_cast<char>('0' + fields[i] / 10);
+            buffer[2 + i * 3] = static_cast<char>('0' + fields[i] % 10);
+            buffer[3 + i * 3] = i < 2 ? ':' : ']';
+        }
+        buffer[10] = ' ';
+        buffer[11] = '\0';
+        return std::string_view(buffer, 11);
+    }
+
+    // "/history" start time in Unix microseconds: a lookback such as 30s, 15m, 2h or 7d,
+    // or absolute Unix seconds (0 = from the beginning).
+    std::optional<uint64_t> parseHistorySince(std::string_view text) {
+        uint64_t value = 0;
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end == text.data()) {
+            return std::nullopt;
+        }
+        const std::string_view unit(end, text.data() + text.size() - end);
+        constexpr uint64_t MICROS_PER_SECOND = 1000000;
+        if (unit.empty()) {
+            if (value > UINT64_MAX / MICROS_PER_SECOND) return std::nullopt;
+            return value * MICROS_PER_SECOND;
+        }
+        uint64_t unitSeconds = 0;
+        if (unit == "s") unitSeconds = 1;
+        else if (unit == "m") unitSeconds = 60;
+        else if (unit == "h") unitSeconds = 3600;
+        else if (unit == "d") unitSeconds = 86400;
+        else return std::nullopt;
+        if (value > UINT64_MAX / (unitSeconds * MICROS_PER_SECOND)) {
+            return std::nullopt;
+        }
+        const auto now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        const uint64_t lookback = value * unitSeconds * MICROS_PER_SECOND;
+        return lookback < now ? now - lookback : 0;
+    }
+}
 
 MessageManager::MessageManager(ClientManager& clientManager, ChannelManager& channelManager)
     : clientManager_(clientManager), channelManager_(channelManager) {
-    setupDefaultCommands();
+    static_assert(BUILTIN_NAMES.size() == BUILTIN_COMMAND_COUNT);
+    for (size_t i = 0; i < BUILTIN_COMMAND_COUNT; ++i) {
+        builtinLatencySlots_[i] = LatencyMetrics::global().registerCommand(std::string(BUILTIN_NAMES[i]));
+    }
 }
 
-void MessageManager::handleMessage(std::shared_ptr<Client> sender, const std::string& message) {
+void MessageManager::handleMessage(const std::shared_ptr<Client>& sender, std::string_view message) {
     if (!sender) return;
-    processedMessages_++;
-    receivedBytes_ += message.length();
-    std::string cleanMessage = message;
+    processedMessages_.add();
+    std::string_view cleanMessage = message;
     if (!cleanMessage.empty() && cleanMessage.back() == '\r') {
-        cleanMessage.pop_back();
+        cleanMessage.remove_suffix(1);
     }
     if (cleanMessage.empty()) return;
 
     if (cleanMessage.starts_with("/")) {
         handleCommand(sender, cleanMessage);
     } else {
-        const std::string& activeChannel = sender->getActiveChannel();
-        if (!activeChannel.empty()) {
-            sendChannelMessage(sender, activeChannel, cleanMessage);
+        auto activeChannel = channelManager_.getChannel(sender->getActiveChannel());
+        if (activeChannel) {
+            sendChannelMessage(sender, *activeChannel, cleanMessage);
         } else {
             sendServerMessage(sender, "You are not in any channel. Join one with /join <#channel> or send a private message with /msg <user> <message>.");
         }
     }
 }
 
-void MessageManager::handleCommand(std::shared_ptr<Client> sender, const std::string& commandLine) {
+void MessageManager::handleCommand(const std::shared_ptr<Client>& sender, std::string_view commandLine) {
     if (!sender || commandLine.empty()) return;
-    processedCommands_++;
-    auto args = parseCommandArgs(commandLine);
-    if (args.empty()) return;
-    std::string command = args[0].substr(1);
-    args.erase(args.begin());
-    auto it = commandHandlers_.find(command);
-    if (it != commandHandlers_.end()) {
-        it->second(sender, args);
-    } else {
-        sendServerMessage(sender, "Unknown command: " + command);
+    processedCommands_.add();
+    const uint64_t startedAt = LatencyMetrics::now();
+    const CommandLine command(commandLine);
+    if (!commandHandlers_.empty()) {
+        auto it = commandHandlers_.find(command.getName());
+        if (it != commandHandlers_.end()) {
+            it->second.handler(sender, command);
+            LatencyMetrics::global().recordCommand(it->second.latencySlot, LatencyMetrics::now() - startedAt);
+            return;
+        }
+    }
+    const int builtin = findBuiltin(command.getName());
+    if (!dispatchBuiltin(sender, builtin, command)) {
+        sendServerMessage(sender, "Unknown command: " + std::string(command.getName()));
+        return;
+    }
+    LatencyMetrics::global().recordCommand(builtinLatencySlots_[builtin], LatencyMetrics::now() - startedAt);
+}
+
+bool MessageManager::dispatchBuiltin(const std::shared_ptr<Client>& client, int index, const CommandLine& command) {
+    if (index < 0 || builtinDisabled_[index]) return false;
+    switch (static_cast<BuiltinCommand>(index)) {
+        case BuiltinCommand::Nick: handleNickCommand(client, command); break;
+        case BuiltinCommand::Join: handleJoinCommand(client, command); break;
+        case BuiltinCommand::Part: handlePartCommand(client, command); break;
+        case BuiltinCommand::Quit: handleQuitCommand(client, command); break;
+        case BuiltinCommand::List: handleListCommand(client, command); break;
+        case BuiltinCommand::Who: handleWhoCommand(client, command); break;
+        case BuiltinCommand::Msg: handlePrivmsgCommand(client, command); break;
+        case BuiltinCommand::Motd: handleMotdCommand(client, command); break;
+        case BuiltinCommand::Help: handleHelpCommand(client, command); break;
+        case BuiltinCommand::History: handleHistoryCommand(client, command); break;
+        case BuiltinCommand::Count: return false;
     }
+    return true;
 }
 
 void MessageManager::broadcastMessage(std::shared_ptr<Client> sender, const std::string& message) {
     if (!sender) return;
-    sentMessages_++;
-    sentBytes_ += message.length();
+    sentMessages_.add();
     clientManager_.broadcastMessage(message, sender);
 }
 
-void MessageManager::sendPrivateMessage(std::shared_ptr<Client> sender, const std::string& recipient, const std::string& message) {
+void MessageManager::sendPrivateMessage(std::shared_ptr<Client> sender, std::string_view recipient, std::string_view message) {
     if (!sender) return;
     auto targetClient = clientManager_.getClientByNickname(recipient);
     if (!targetClient) {
-        sendServerMessage(sender, "User " + recipient + " not found.");
+        sentMessages_.add();
+        clientManager_.sendMessageToClient(sender, MessagePayload::concat({"*** User ", recipient, " not found.\n"}));
         return;
     }
-    sentMessages_++;
-    sentBytes_ += message.length();
-    std::string formattedMsg = "*Private from " + sender->getNickname() + ": " + message;
-    clientManager_.sendMessageToClient(targetClient, formattedMsg);
-    std::string copyMsg = "*Private to " + recipient + ": " + message;
-    clientManager_.sendMessageToClient(sender, copyMsg);
+    sentMessages_.add();
+    clientManager_.sendMessageToClient(targetClient, MessagePayload::concat({"*Private from ", sender->getNickname(), ": ", message, "\n"}));
+    clientManager_.sendMessageToClient(sender, MessagePayload::concat({"*Private to ", recipient, ": ", message, "\n"}));
+    LatencyMetrics::global().recordSinceLineParsed(LatencyStage::ParsedToEnqueued);
+    if (chatLog_) {
+        chatLog_->appendPrivateMessage(sender->getNickname(), recipient, message);
+    }
 }
 
-void MessageManager::sendChannelMessage(std::shared_ptr<Client> sender, const std::string& channelName, const std::string& message) {
+void MessageManager::sendChannelMessage(std::shared_ptr<Client> sender, const std::string& channelName, std::string_view message) {
     if (!sender) return;
-    if (!channelManager_.channelExists(channelName)) {
+    auto channel = channelManager_.getChannel(channelName);
+    if (!channel) {
         sendServerMessage(sender, "Channel " + channelName + " does not exist.");
         return;
     }
-    auto clientChannels = channelManager_.getClientChannels(sender);
-    bool isInChannel = std::find(clientChannels.begin(), clientChannels.end(), channelName) != clientChannels.end();
-    if (!isInChannel) {
-        sendServerMessage(sender, "You are not in channel " + channelName);
+    sendChannelMessage(sender, *channel, message);
+}
+
+void MessageManager::sendChannelMessage(const std::shared_ptr<Client>& sender, Channel& channel, std::string_view message) {
+    if (!channel.hasMember(*sender)) {
+        sendServerMessage(sender, "You are not in channel " + channel.getName());
         return;
     }
-    sentMessages_++;
-    sentBytes_ += message.length();
-    std::string formattedMsg = "<" + sender->getNickname() + "@" + channelName + "> " + message;
-    channelManager_.broadcastToChannel(channelName, formattedMsg);
+    sentMessages_.add();
+    // Format the wire line once; every member's queue shares this one buffer.
+    PayloadRef formattedMsg = MessagePayload::concat({"<", sender->getNickname(), "@", channel.getName(), "> ", message, "\n"});
+    channel.broadcastMessage(formattedMsg);
+    LatencyMetrics::global().recordSinceLineParsed(LatencyStage::ParsedToEnqueued);
+    if (channel.hasHistory()) {
+        char timestamp[12];
+        channel.recordHistory(MessagePayload::concat({formatHistoryTime(timestamp), formattedMsg->view()}));
+    }
+    if (chatLog_) {
+        chatLog_->appendChannelMessage(sender->getNickname(), channel.getName(), message);
+    }
 }
 
 void MessageManager::sendServerMessage(std::shared_ptr<Client> client, const std::string& message) {
     if (!client) return;
-    sentMessages_++;
-    sentBytes_ += message.length();
+    sentMessages_.add();
     std::string formattedMsg = "*** " + message;
     clientManager_.sendMessageToClient(client, formattedMsg);
 }
 
 void MessageManager::registerCommand(const std::string& name, CommandHandler handler) {
-    commandHandlers_[name] = std::move(handler);
+    const size_t latencySlot = LatencyMetrics::global().registerCommand(name);
+    commandHandlers_[name] = RegisteredCommand{std::move(handler), latencySlot};
 }
 
 void MessageManager::unregisterCommand(const std::string& name) {
     commandHandlers_.erase(name);
+    const int builtin = findBuiltin(name);
+    if (builtin >= 0) {
+        builtinDisabled_[builtin] = true;
+    }
 }
 
 size_t MessageManager::getProcessedMessagesCount() const { return processedMessages_.load(); }
 size_t MessageManager::getProcessedCommandsCount() const { return processedCommands_.load(); }
 size_t MessageManager::getSentMessagesCount() const { return sentMessages_.load(); }
-size_t MessageManager::getReceivedBytesCount() const { return receivedBytes_.load(); }
-size_t MessageManager::getSentBytesCount() const { return sentBytes_.load(); }
 void MessageManager::setMotd(const std::string& motd) { motd_ = motd; }
 std::string MessageManager::getMotd() const { return motd_; }
+void MessageManager::setChatLog(ChatLog* chatLog) { chatLog_ = chatLog; }
+void MessageManager::setHistoryService(HistoryService* historyService) { historyService_ = historyService; }
 
-std::vector<std::string> MessageManager::parseCommandArgs(const std::string& commandLine) {
-    std::vector<std::string> args;
-    std::istringstream iss(commandLine);
-    std::string arg;
-    while (iss >> arg) {
-        args.push_back(arg);
-    }
-    return args;
-}
-
-void MessageManager::setupDefaultCommands() {
-    registerCommand("nick", [this](auto c, auto a){ this->handleNickCommand(c, a); });
-    registerCommand("join", [this](auto c, auto a){ this->handleJoinCommand(c, a); });
-    registerCommand("part", [this](auto c, auto a){ this->handlePartCommand(c, a); });
-    registerCommand("quit", [this](auto c, auto a){ this->handleQuitCommand(c, a); });
-    registerCommand("list", [this](auto c, auto a){ this->handleListCommand(c, a); });
-    registerCommand("who", [this](auto c, auto a){ this->handleWhoCommand(c, a); });
-    registerCommand("msg", [this](auto c, auto a){ this->handlePrivmsgCommand(c, a); });
-    registerCommand("motd", [this](auto c, auto a){ this->handleMotdCommand(c, a); });
-    registerCommand("help", [this](auto c, auto a){ this->handleHelpCommand(c, a); });
-}
-
-void MessageManager::handleNickCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
-    if (args.empty()) {
+void MessageManager::handleNickCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    if (!command.hasArgs()) {
         sendServerMessage(client, "Usage: /nick <new_nick>");
         return;
     }
-    std::string newNickname = args[0];
+    std::string newNickname(command.getArg(0));
     if (clientManager_.clientExistsByNickname(newNickname) && clientManager_.getClientByNickname(newNickname) != client) {
         sendServerMessage(client, "Nickname '" + newNickname + "' already in use.");
         return;
@@ -153,18 +287,26 @@ void MessageManager::handleNickCommand(std::shared_ptr<Client> client, const std
     clientManager_.broadcastMessage(notificationMsg);
 }
 
-void MessageManager::handleJoinCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
-    if (args.empty()) {
+void MessageManager::handleJoinCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    if (!command.hasArgs()) {
         sendServerMessage(client, "Usage: /join <#channel>");
         return;
     }
-    std::string channelName = args[0];
+    std::string channelName(command.getArg(0));
     if (!channelName.starts_with("#")) {
-        channelName = "#" + channelName;
+        channelName.insert(0, 1, '#');
     }
     if (channelManager_.joinChannel(client, channelName)) {
-        client->setActiveChannel(channelName);
+        auto channel = channelManager_.getChannel(channelName);
+        if (channel) {
+            client->setActiveChannel(channel->getId());
+        }
         sendServerMessage(client, "You joined " + channelName + " (now active).");
+        if (channel) {
+            // The stored lines are already formatted, so the whole replay is one enqueue.
+            const auto history = channel->getHistory();
+            client->pushMessagesToQueue(history.data(), history.size(), MessageKind::Broadcast);
+        }
         std::string joinMsg = client->getNickname() + " joined the channel.";
         channelManager_.broadcastToChannel(channelName, "*** " + joinMsg);
     } else {
@@ -172,47 +314,43 @@ void MessageManager::handleJoinCommand(std::shared_ptr<Client> client, const std
     }
 }
 
-void MessageManager::handlePartCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
-    if (args.empty()) {
+void MessageManager::handlePartCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    if (!command.hasArgs()) {
         sendServerMessage(client, "Usage: /part <#channel>");
         return;
     }
-    std::string channelName = args[0];
+    std::string channelName(command.getArg(0));
     if (!channelName.starts_with("#")) {
-        channelName = "#" + channelName;
+        channelName.insert(0, 1, '#');
     }
-    auto clientChannels = channelManager_.getClientChannels(client);
-    bool isInChannel = std::find(clientChannels.begin(), clientChannels.end(), channelName) != clientChannels.end();
-    if (!isInChannel) {
+    auto channel = channelManager_.getChannel(channelName);
+    if (!channel || !channel->hasMember(*client)) {
         sendServerMessage(client, "You are not in channel " + channelName);
         return;
     }
-    std::string partMsg = client->getNickname() + " left the channel.";
-    channelManager_.broadcastToChannel(channelName, "*** " + partMsg);
-    if (channelManager_.leaveChannel(client, channelName)) {
+    channel->broadcastMessage(MessagePayload::concat({"*** ", client->getNickname(), " left the channel.\n"}));
+    if (channelManager_.leaveChannel(client, *channel)) {
         sendServerMessage(client, "You have left " + channelName);
     } else {
         sendServerMessage(client, "Error leaving channel " + channelName);
     }
 }
 
-void MessageManager::handleQuitCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
-    std::string quitMessage = "Client quit.";
-    if (!args.empty()) {
-        quitMessage = args[0];
-        for (size_t i = 1; i < args.size(); ++i) {
-            quitMessage += " " + args[i];
-        }
+void MessageManager::handleQuitCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    std::string_view quitMessage = "Client quit.";
+    if (command.hasArgs()) {
+        quitMessage = command.getTrailing(0);
     }
-    auto channels = channelManager_.getClientChannels(client);
-    std::string notificationMsg = client->getNickname() + " left the server: " + quitMessage;
-    for (const auto& channelName : channels) {
-        channelManager_.broadcastToChannel(channelName, "*** " + notificationMsg);
+    PayloadRef notificationMsg = MessagePayload::concat({"*** ", client->getNickname(), " left the server: ", quitMessage, "\n"});
+    for (ChannelId channelId : client->getJoinedChannels()) {
+        if (auto channel = channelManager_.getChannel(channelId)) {
+            channel->broadcastMessage(notificationMsg);
+        }
     }
     clientManager_.removeClient(client);
 }
 
-void MessageManager::handleListCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
+void MessageManager::handleListCommand(std::shared_ptr<Client> client, const CommandLine&) {
     auto channels = channelManager_.getChannelList();
     if (channels.empty()) {
         sendServerMessage(client, "No active channels.");
@@ -225,8 +363,8 @@ void MessageManager::handleListCommand(std::shared_ptr<Client> client, const std
     }
 }
 
-void MessageManager::handleWhoCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
-    if (args.empty()) {
+void MessageManager::handleWhoCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    if (!command.hasArgs()) {
         auto clients = clientManager_.getAllClients();
         if (clients.empty()) {
             sendServerMessage(client, "No users online.");
@@ -245,13 +383,13 @@ void MessageManager::handleWhoCommand(std::shared_ptr<Client> client, const std:
             sendServerMessage(client, "- " + c->getNickname() + channelsStr);
         }
     } else {
-        std::string channelName = args[0];
+        std::string channelName(command.getArg(0));
         if (!channelName.starts_with("#")) {
-            channelName = "#" + channelName;
+            channelName.insert(0, 1, '#');
         }
-        auto channelOpt = channelManager_.getChannel(channelName);
-        if(channelOpt) {
-            auto nicknames = channelOpt.value().get().getMemberNicknames();
+        auto channel = channelManager_.getChannel(channelName);
+        if (channel) {
+            auto nicknames = channel->getMemberNicknames();
             sendServerMessage(client, "Users in " + channelName + " (" + std::to_string(nicknames.size()) + "):");
             for(const auto& nick : nicknames) {
                 sendServerMessage(client, "- " + nick);
@@ -262,24 +400,21 @@ void MessageManager::handleWhoCommand(std::shared_ptr<Client> client, const std:
     }
 }
 
-void MessageManager::handlePrivmsgCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
-    if (args.size() < 2) {
+void MessageManager::handlePrivmsgCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    if (command.getArgCount() < 2) {
         sendServerMessage(client, "Usage: /msg <#channel_or_user> <message>");
         return;
     }
-    std::string recipient = args[0];
-    std::string message;
-    for (size_t i = 1; i < args.size(); ++i) {
-        message += args[i] + (i < args.size() - 1 ? " " : "");
-    }
+    const std::string_view recipient = command.getArg(0);
+    const std::string_view message = command.getTrailing(1);
     if (recipient.starts_with("#")) {
-        sendChannelMessage(client, recipient, message);
+        sendChannelMessage(client, std::string(recipient), message);
     } else {
         sendPrivateMessage(client, recipient, message);
     }
 }
 
-void MessageManager::handleMotdCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
+void MessageManager::handleMotdCommand(std::shared_ptr<Client> client, const CommandLine&) {
     if (motd_.empty()) {
         sendServerMessage(client, "No MOTD available.");
     } else {
@@ -288,7 +423,7 @@ void MessageManager::handleMotdCommand(std::shared_ptr<Client> client, const std
     }
 }
 
-void MessageManager::handleHelpCommand(std::shared_ptr<Client> client, const std::vector<std::string>& args) {
+void MessageManager::handleHelpCommand(std::shared_ptr<Client> client, const CommandLine&) {
     sendServerMessage(client, "Available commands:");
     sendServerMessage(client, "/nick <name>              - Change your nickname");
     sendServerMessage(client, "/join <#channel>          - Join a channel");
@@ -298,5 +433,46 @@ void MessageManager::handleHelpCommand(std::shared_ptr<Client> client, const std
     sendServerMessage(client, "/who [#channel]           - List users on server or in a channel");
     sendServerMessage(client, "/motd                     - Show the Message of the Day");
     sendServerMessage(client, "/quit [message]           - Disconnect from the server");
+    sendServerMessage(client, "/history <#channel> [since] [limit] - Replay logged channel messages");
     sendServerMessage(client, "/help                     - Show this help message");
+}
+
+void MessageManager::handleHistoryCommand(std::shared_ptr<Client> client, const CommandLine& command) {
+    if (!historyService_) {
+        sendServerMessage(client, "History is not available on this server.");
+        return;
+    }
+    if (!command.hasArgs()) {
+        sendServerMessage(client, "Usage: /history <#channel> [since: 15m, 2h, 7d or Unix seconds] [limit]");
+        return;
+    }
+    std::string channelName(command.getArg(0));
+    if (!channelName.starts_with("#")) {
+        channelName.insert(0, 1, '#');
+    }
+    // The log outlives membership, so only current members may read a channel's past.
+    auto channel = channelManager_.getChannel(channelName);
+    if (!channel || !channel->hasMember(*client)) {
+        sendServerMessage(client, "You are not in channel " + channelName);
+        return;
+    }
+    uint64_t sinceMicros = 0;
+    if (command.getArgCount() > 1) {
+        const auto since = parseHistorySince(command.getArg(1));
+        if (!since) {
+            sendServerMessage(client, "Invalid start time, expected e.g. 15m, 2h, 7d or Unix seconds.");
+            return;
+        }
+        sinceMicros = *since;
+    }
+    size_t limit = DEFAULT_HISTORY_LIMIT;
+    if (command.getArgCount() > 2) {
+        const std::string_view text = command.getArg(2);
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), limit);
+        if (error != std::errc() || end != text.data() + text.size() || limit == 0) {
+            sendServerMessage(client, "Invalid limit.");
+            return;
+        }
+    }
+    historyService_->requestChannelHistory(client, std::move(channelName), sinceMicros, limit);
 }
\ No newline at end of file
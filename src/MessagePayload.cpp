@@ -0,0 +1,41 @@
+#include "MessagePayload.h"
+#include "LatencyMetrics.h"
+#include "BlockPool.h"
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <limits>
+
+MessagePayload* MessagePayload::allocate(size_t size) {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Message payload too large");
+    }
+    void* memory = BlockPool::allocate(sizeof(MessagePayload) + size);
+    return new (memory) MessagePayload(static_cast<uint32_t>(size), LatencyMetrics::now());
+}
+
+void MessagePayload::release(MessagePayload* payload) {
+    const size_t bytes = sizeof(MessagePayload) + payload->size_;
+    payload->~MessagePayload();
+    BlockPool::deallocate(payload, bytes);
+}
+
+PayloadRef MessagePayload::create(std::string_view text) {
+    MessagePayload* payload = allocate(text.size());
+    std::memcpy(payload->mutableData(), text.data(), text.size());
+    return PayloadRef(payload);
+}
+
+PayloadRef MessagePayload::concat(std::initializer_list<std::string_view> parts) {
+    size_t size = 0;
+    for (const auto& part : parts) {
+        size += part.size();
+    }
+    MessagePayload* payload = allocate(size);
+    char* out = payload->mutableData();
+    for (const auto& part : parts) {
+        std::memcpy(out, part.data(), part.size());
+        out += part.size();
+    }
+    return PayloadRef(payload);
+}
@@ -0,0 +1,187 @@
+#include "MetricsServer.h"
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int IO_TIMEOUT_SECONDS = 2;
+
+    bool sendAll(int socket, const char* data, size_t length) {
+        while (length > 0) {
+            const ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += sent;
+            length -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    std::string httpResponse(const char* status, const char* contentType, const std::string& body) {
+        std::string response = std::string("HTTP/1.0 ") + status + "\r\n"
+            + "Content-Type: " + contentType + "\r\n"
+            + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            + "Connection: close\r\n\r\n";
+        response += body;
+        return response;
+    }
+}
+
+MetricsServer::MetricsServer(const std::string& address, int port) {
+    sockaddr_in hint{};
+    hint.sin_family = AF_INET;
+    hint.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &hint.sin_addr) != 1) {
+        throw std::system_error(EINVAL, std::system_category(), "Invalid metrics address " + address);
+    }
+    listeningSocket_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listeningSocket_ == -1) {
+        throw std::system_error(errno, std::system_category(), "Failed to create metrics socket");
+    }
+    int reuse = 1;
+    setsockopt(listeningSocket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listeningSocket_, reinterpret_cast<sockaddr*>(&hint), sizeof(hint)) == -1 ||
+        listen(listeningSocket_, 16) == -1) {
+        const int error = errno;
+        close(listeningSocket_);
+        throw std::system_error(error, std::system_category(), "Failed to open metrics listener");
+    }
+    wakeFd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd_ == -1) {
+        const int error = errno;
+        close(listeningSocket_);
+        throw std::system_error(error, std::system_category(), "Failed to create metrics eventfd");
+    }
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close(wakeFd_);
+    close(listeningSocket_);
+}
+
+void MetricsServer::setOnScrapeCallback(ScrapeCallback callback) {
+    onScrape_ = std::move(callback);
+}
+
+void MetricsServer::setRequestHandler(const std::string& path, RequestHandler handler) {
+    handlers_[path] = std::move(handler);
+}
+
+std::string MetricsServer::getQueryParameter(std::string_view query, std::string_view name) {
+    auto hexValue = [](char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    while (!query.empty()) {
+        const size_t end = std::min(query.find('&'), query.size());
+        const std::string_view pair = query.substr(0, end);
+        query.remove_prefix(std::min(end + 1, query.size()));
+        const size_t equals = pair.find('=');
+        if (pair.substr(0, equals) != name) {
+            continue;
+        }
+        const std::string_view encoded = equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+        std::string value;
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            if (encoded[i] == '+') {
+                value += ' ';
+            } else if (encoded[i] == '%' && i + 2 < encoded.size() && hexValue(encoded[i + 1]) >= 0 && hexValue(encoded[i + 2]) >= 0) {
+                value += static_cast<char>(hexValue(encoded[i + 1]) * 16 + hexValue(encoded[i + 2]));
+                i += 2;
+            } else {
+                value += encoded[i];
+            }
+        }
+        return value;
+    }
+    return {};
+}
+
+void MetricsServer::start() {
+    thread_ = std::thread([this] { run(); });
+}
+
+void MetricsServer::stop() {
+    const uint64_t one = 1;
+    [[maybe_unused]] ssize_t written = write(wakeFd_, &one, sizeof(one));
+}
+
+void MetricsServer::run() {
+    pollfd fds[2] = {{listeningSocket_, POLLIN, 0}, {wakeFd_, POLLIN, 0}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Metrics listener failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            const int clientSocket = accept4(listeningSocket_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (clientSocket >= 0) {
+                serveConnection(clientSocket);
+                close(clientSocket);
+            }
+        }
+    }
+}
+
+void MetricsServer::serveConnection(int socket) {
+    timeval timeout{IO_TIMEOUT_SECONDS, 0};
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+        const ssize_t received = recv(socket, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) return;
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    std::string response;
+    if (request.starts_with("GET /metrics ") || request.starts_with("GET / ")) {
+        try {
+            response = httpResponse("200 OK", "text/plain; version=0.0.4", onScrape_ ? onScrape_() : std::string());
+        } catch (const std::exception& e) {
+            response = httpResponse("500 Internal Server Error", "text/plain", std::string(e.what()) + "\n");
+        }
+    } else if (request.starts_with("GET ")) {
+        const std::string_view target = std::string_view(request).substr(4, request.find(' ', 4) - 4);
+        const size_t question = target.find('?');
+        const auto handler = handlers_.find(std::string(target.substr(0, question)));
+        if (handler == handlers_.end()) {
+            response = httpResponse("404 Not Found", "text/plain", "not found\n");
+        } else {
+            try {
+                const std::string_view query = question == std::string_view::npos ? std::string_view() : target.substr(question + 1);
+                response = httpResponse("200 OK", "text/plain; charset=utf-8", handler->second(query));
+            } catch (const BadRequest& e) {
+                response = httpResponse("400 Bad Request", "text/plain", std::string(e.what()) + "\n");
+            } catch (const std::exception& e) {
+                response = httpResponse("500 Internal Server Error", "text/plain", std::string(e.what()) + "\n");
+            }
+        }
+    } else {
+        response = httpResponse("405 Method Not Allowed", "text/plain", "method not allowed\n");
+    }
+    sendAll(socket, response.data(), response.size());
+}
\ No newline at end of file
@@ -0,0 +1,816 @@
+#include "Reactor.h"
+#include <system_error>
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unordered_set>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    thread_local const Reactor* t_currentReactor = nullptr;
+
+    constexpr uint64_t WAKEUP_TOKEN = 0;
+    constexpr uint64_t LISTENER_TAG = 1ULL << 63;
+    constexpr int USER_DATA_OP_SHIFT = 56;
+    constexpr uint64_t USER_DATA_VALUE_MASK = (1ULL << USER_DATA_OP_SHIFT) - 1;
+}
+
+Reactor::Reactor(size_t shardIndex, IoBackend backend)
+    : shardIndex_(shardIndex), backend_(backend), recvBuffer_(RECV_BUFFER_SIZE) {
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFd_ == -1) {
+        throw std::system_error(errno, std::system_category(), "Failed to create eventfd");
+    }
+    try {
+        if (backend_ == IoBackend::IoUring) {
+            ring_ = std::make_unique<IoUring>(RING_ENTRIES);
+            // Multishot recv has no probe bit of its own; it shipped in 6.0 together with
+            // SEND_ZC, while 5.19 already has buffer rings and would fail every recv.
+            if (!ring_->supportsOpcodes({IORING_OP_POLL_ADD, IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG,
+                                         IORING_OP_ASYNC_CANCEL, IORING_OP_TIMEOUT, IORING_OP_SEND_ZC})) {
+                throw std::system_error(ENOSYS, std::system_category(), "io_uring lacks multishot accept/recv");
+            }
+            ring_->registerBufferRing(RECV_BUFFER_GROUP, RECV_BUFFER_COUNT, RECV_BUFFER_SIZE);
+            armWakeup();
+            return;
+        }
+        epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd_ == -1) {
+            throw std::system_error(errno, std::system_category(), "Failed to create epoll instance");
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = WAKEUP_TOKEN;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeupFd_, &event) == -1) {
+            throw std::system_error(errno, std::system_category(), "Failed to register eventfd");
+        }
+    } catch (...) {
+        if (epollFd_ != -1) close(epollFd_);
+        close(wakeupFd_);
+        throw;
+    }
+}
+
+Reactor::~Reactor() {
+    while (Delivery* delivery = mailbox_.pop()) {
+        delete delivery;
+    }
+    // Tear the ring down first so no in-flight operation still references our buffers.
+    ring_.reset();
+    if (epollFd_ != -1) close(epollFd_);
+    close(wakeupFd_);
+}
+
+void Reactor::addListener(int socket) {
+    listeners_.push_back(socket);
+    if (backend_ == IoBackend::IoUring) {
+        armAccept(socket);
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = LISTENER_TAG | static_cast<uint32_t>(socket);
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event) == -1) {
+        throw std::system_error(errno, std::system_category(), "Failed to register listening socket");
+    }
+}
+
+bool Reactor::addClient(std::shared_ptr<Client> client) {
+    if (!client) return false;
+    const int socket = client->getSocket();
+    const uint64_t connectionId = nextConnectionId_++;
+    if (backend_ == IoBackend::Epoll) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = connectionId;
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event) == -1) {
+            return false;
+        }
+    } else {
+        armRecv(connectionId, socket);
+    }
+    client->setReactor(this, connectionId);
+    client->setShardStats(&stats_);
+    ShardStats::add<int64_t>(stats_.queuedBytes, static_cast<int64_t>(client->getQueuedBytes()));
+    ShardStats::add<uint64_t>(stats_.connectionsAccepted, 1);
+    clients_[connectionId].client = std::move(client);
+    clientCount_++;
+    return true;
+}
+
+void Reactor::removeClient(std::shared_ptr<Client> client) {
+    if (!client) return;
+    if (isInLoopThread()) {
+        removeClient_UNLOCKED(client);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pendingRemovals_.push_back(std::move(client));
+    }
+    wakeup();
+}
+
+void Reactor::removeClient_UNLOCKED(const std::shared_ptr<Client>& client) {
+    auto it = clients_.find(client->getConnectionId());
+    if (it == clients_.end() || it->second.client != client) {
+        return;
+    }
+    clientCount_--;
+    ShardStats::add<int64_t>(stats_.queuedBytes, -static_cast<int64_t>(client->getQueuedBytes()));
+    ShardStats::add<uint64_t>(stats_.connectionsClosed, 1);
+    client->setShardStats(nullptr);
+    // An in-flight SENDMSG still references the queued payloads; keep them alive until it completes.
+    if (it->second.sendInFlight) {
+        retired_.insert(clients_.extract(it));
+        return;
+    }
+    clients_.erase(it);
+}
+
+bool Reactor::isRegistered(const Client* client) const {
+    auto it = clients_.find(client->getConnectionId());
+    return it != clients_.end() && it->second.client.get() == client;
+}
+
+void Reactor::scheduleFlush(std::shared_ptr<Client> client) {
+    localFlushes_.push_back(std::move(client));
+}
+
+void Reactor::requestDisconnect(std::shared_ptr<Client> client) {
+    localDisconnects_.push_back(std::move(client));
+}
+
+void Reactor::watchCongestion(std::shared_ptr<Client> client) {
+    if (congestedClients_.empty()) {
+        nextCongestionCheck_ = std::chrono::steady_clock::now() + CONGESTION_CHECK_INTERVAL;
+    }
+    congestedClients_.push_back(std::move(client));
+    if (ring_ && !congestionCheckArmed_) {
+        armCongestionCheck();
+    }
+}
+
+void Reactor::checkCongestion() {
+    const auto now = std::chrono::steady_clock::now();
+    nextCongestionCheck_ = now + CONGESTION_CHECK_INTERVAL;
+    std::erase_if(congestedClients_, [this, now](const std::shared_ptr<Client>& client) {
+        return !isRegistered(client) || !client->checkCongestionDeadline(now);
+    });
+}
+
+void Reactor::post(std::vector<Client*> recipients, std::shared_ptr<const void> keepAlive, PayloadRef message, MessageKind kind) {
+    auto* delivery = new Delivery;
+    delivery->kind = kind;
+    delivery->recipients = std::move(recipients);
+    delivery->keepAlive = std::move(keepAlive);
+    delivery->message = std::move(message);
+    mailbox_.push(delivery);
+    if (!mailboxSignalled_.exchange(true)) {
+        wakeup();
+    }
+}
+
+void Reactor::wakeup() {
+    const uint64_t one = 1;
+    // Any thread may call this: posting threads, and stop() from the signal-handling thread.
+    [[maybe_unused]] auto written = write(wakeupFd_, &one, sizeof(one));
+}
+
+void Reactor::drainWakeupFd() {
+    uint64_t value;
+    [[maybe_unused]] auto bytesRead = read(wakeupFd_, &value, sizeof(value));
+}
+
+void Reactor::stop() {
+    stopRequested_ = true;
+    wakeup();
+}
+
+bool Reactor::isInLoopThread() const {
+    return t_currentReactor == this;
+}
+
+IoBackend Reactor::getBackend() const {
+    return backend_;
+}
+
+size_t Reactor::getShardIndex() const {
+    return shardIndex_;
+}
+
+const ShardStats& Reactor::getShardStats() const {
+    return stats_;
+}
+
+size_t Reactor::getClientCount() const {
+    return clientCount_.load();
+}
+
+void Reactor::run() {
+    t_currentReactor = this;
+    try {
+        if (backend_ == IoBackend::IoUring) {
+            runIoUring();
+        } else {
+            runEpoll();
+        }
+    } catch (...) {
+        t_currentReactor = nullptr;
+        throw;
+    }
+    t_currentReactor = nullptr;
+}
+
+void Reactor::runEpoll() {
+    epoll_event events[MAX_EVENTS];
+    while (!stopRequested_.load()) {
+        int timeout = -1;
+        if (!congestedClients_.empty()) {
+            const auto untilCheck = std::chrono::ceil<std::chrono::milliseconds>(nextCongestionCheck_ - std::chrono::steady_clock::now());
+            timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(untilCheck.count(), 0));
+        }
+        const int count = epoll_wait(epollFd_, events, MAX_EVENTS, timeout);
+        if (count == -1) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::system_category(), "epoll_wait failed");
+        }
+        for (int i = 0; i < count; ++i) {
+            const uint64_t token = events[i].data.u64;
+            const uint32_t mask = events[i].events;
+            if (token == WAKEUP_TOKEN) {
+                drainWakeupFd();
+                continue;
+            }
+            if (token & LISTENER_TAG) {
+                acceptConnections(static_cast<int>(token & ~LISTENER_TAG));
+                continue;
+            }
+            auto it = clients_.find(token);
+            if (it == clients_.end()) continue;
+            auto client = it->second.client;
+            if (mask & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                readClient(client);
+            }
+            if ((mask & EPOLLOUT) && isRegistered(client)) {
+                client->setWriteBlocked(false);
+                if (onWritableCallback_) onWritableCallback_(client);
+            }
+        }
+        if (!congestedClients_.empty() && std::chrono::steady_clock::now() >= nextCongestionCheck_) {
+            checkCongestion();
+        }
+        processPending();
+    }
+}
+
+void Reactor::acceptConnections(int listeningSocket) {
+    while (!stopRequested_.load()) {
+        int clientSocket = accept4(listeningSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientSocket == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+        if (onConnectionCallback_) {
+            onConnectionCallback_(clientSocket);
+        } else {
+            close(clientSocket);
+        }
+    }
+}
+
+void Reactor::readClient(const std::shared_ptr<Client>& client) {
+    const int socket = client->getSocket();
+    while (isRegistered(client)) {
+        const ssize_t bytesReceived = recv(socket, recvBuffer_.data(), recvBuffer_.size(), 0);
+        if (bytesReceived > 0) {
+            ShardStats::add<uint64_t>(stats_.bytesRead, static_cast<uint64_t>(bytesReceived));
+            if (onInputCallback_) onInputCallback_(client, recvBuffer_.data(), static_cast<size_t>(bytesReceived));
+            continue;
+        }
+        if (bytesReceived == -1 && errno == EINTR) {
+            continue;
+        }
+        if (bytesReceived == -1 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+            return;
+        }
+        if (onDisconnectCallback_) onDisconnectCallback_(client);
+        return;
+    }
+}
+
+void Reactor::runIoUring() {
+    while (!stopRequested_.load()) {
+        const int submitted = ring_->submitAndWait(1);
+        if (submitted < 0 && submitted != -EINTR && submitted != -EAGAIN && submitted != -EBUSY) {
+            throw std::system_error(-submitted, std::system_category(), "io_uring_enter failed");
+        }
+        while (io_uring_cqe* entry = ring_->peekCqe()) {
+            const io_uring_cqe cqe = *entry;
+            ring_->advanceCq(1);
+            handleCompletion(cqe);
+        }
+        // Every buffer this batch consumed is back in the ring by now.
+        if (!starvedRecvs_.empty()) {
+            rearmStarvedRecvs();
+        }
+        processPending();
+    }
+}
+
+void Reactor::armWakeup() {
+    io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wakeupFd_;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = static_cast<uint64_t>(UringOp::Wakeup) << USER_DATA_OP_SHIFT;
+}
+
+void Reactor::armAccept(int listeningSocket) {
+    io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listeningSocket;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = (static_cast<uint64_t>(UringOp::Accept) << USER_DATA_OP_SHIFT) | static_cast<uint32_t>(listeningSocket);
+}
+
+void Reactor::armRecv(uint64_t connectionId, int socket) {
+    io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = socket;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BUFFER_GROUP;
+    sqe->user_data = (static_cast<uint64_t>(UringOp::Recv) << USER_DATA_OP_SHIFT) | connectionId;
+}
+
+void Reactor::handleCompletion(const io_uring_cqe& cqe) {
+    const auto op = static_cast<UringOp>(cqe.user_data >> USER_DATA_OP_SHIFT);
+    const uint64_t value = cqe.user_data & USER_DATA_VALUE_MASK;
+    const bool more = cqe.flags & IORING_CQE_F_MORE;
+    switch (op) {
+        case UringOp::Wakeup:
+            drainWakeupFd();
+            if (!more) armWakeup();
+            break;
+        case UringOp::Accept:
+            if (cqe.res >= 0) {
+                if (onConnectionCallback_) {
+                    onConnectionCallback_(cqe.res);
+                } else {
+                    close(cqe.res);
+                }
+            }
+            if (more || stopRequested_.load()) break;
+            if (cqe.res >= 0 || cqe.res == -EINTR || cqe.res == -ECONNABORTED || cqe.res == -EAGAIN) {
+                armAccept(static_cast<int>(value));
+            } else if (cqe.res == -EMFILE || cqe.res == -ENFILE || cqe.res == -ENOBUFS || cqe.res == -ENOMEM) {
+                // Out of descriptors or memory: retry later instead of failing in a tight loop.
+                std::cerr << "accept failed: " << std::strerror(-cqe.res) << ", retrying in "
+                          << ACCEPT_BACKOFF.count() << " ms" << std::endl;
+                armAcceptBackoff(static_cast<int>(value));
+            } else {
+                std::cerr << "accept failed: " << std::strerror(-cqe.res) << ", listener disabled" << std::endl;
+            }
+            break;
+        case UringOp::Recv: {
+            auto it = clients_.find(value);
+            std::shared_ptr<Client> client = it != clients_.end() ? it->second.client : nullptr;
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                const auto bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                ShardStats::add<uint64_t>(stats_.bytesRead, static_cast<uint64_t>(cqe.res));
+                if (client && onInputCallback_) {
+                    onInputCallback_(client, ring_->getBuffer(bufferId), static_cast<size_t>(cqe.res));
+                }
+                ring_->recycleBuffer(bufferId);
+                if (!more && client && isRegistered(client)) armRecv(value, client->getSocket());
+            } else if (cqe.res == -ENOBUFS) {
+                // The ring ran dry; completions ahead of this one hold the buffers.
+                if (client) starvedRecvs_.push_back(value);
+            } else if (client && onDisconnectCallback_) {
+                onDisconnectCallback_(client);
+            }
+            break;
+        }
+        case UringOp::Send:
+            handleSendCompletion(value, cqe.res);
+            break;
+        case UringOp::AcceptBackoff:
+            if (!stopRequested_.load()) armAccept(static_cast<int>(value));
+            break;
+        case UringOp::CongestionCheck:
+            congestionCheckArmed_ = false;
+            checkCongestion();
+            if (!congestedClients_.empty()) armCongestionCheck();
+            break;
+        case UringOp::Cancel:
+        case UringOp::Timeout:
+            break;
+    }
+}
+
+void Reactor::armAcceptBackoff(int listeningSocket) {
+    io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    // Read by the kernel at submission, so it must outlive this call.
+    sqe->addr = reinterpret_cast<uint64_t>(&acceptBackoff_);
+    sqe->len = 1;
+    sqe->user_data = (static_cast<uint64_t>(UringOp::AcceptBackoff) << USER_DATA_OP_SHIFT) | static_cast<uint32_t>(listeningSocket);
+}
+
+void Reactor::armCongestionCheck() {
+    io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&congestionCheckInterval_);
+    sqe->len = 1;
+    sqe->user_data = static_cast<uint64_t>(UringOp::CongestionCheck) << USER_DATA_OP_SHIFT;
+    congestionCheckArmed_ = true;
+}
+
+void Reactor::rearmStarvedRecvs() {
+    std::vector<uint64_t> starved;
+    starved.swap(starvedRecvs_);
+    for (uint64_t connectionId : starved) {
+        auto it = clients_.find(connectionId);
+        if (it != clients_.end()) armRecv(connectionId, it->second.client->getSocket());
+    }
+}
+
+void Reactor::flushIoUring(uint64_t connectionId, Connection& connection) {
+    if (connection.sendInFlight || !connection.client->hasPendingOutput()) {
+        return;
+    }
+    io_uring_sqe* sqe = ring_->getSqe();
+    if (!sqe) return;
+    connection.sendIov.resize(SEND_IOV_MAX);
+    connection.sendMessage = msghdr{};
+    connection.sendMessage.msg_iov = connection.sendIov.data();
+    connection.sendMessage.msg_iovlen = connection.client->gatherOutput(connection.sendIov.data(), SEND_IOV_MAX);
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = connection.client->getSocket();
+    sqe->addr = reinterpret_cast<uint64_t>(&connection.sendMessage);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (static_cast<uint64_t>(UringOp::Send) << USER_DATA_OP_SHIFT) | connectionId;
+    connection.sendInFlight = true;
+}
+
+void Reactor::handleSendCompletion(uint64_t connectionId, int result) {
+    auto it = clients_.find(connectionId);
+    if (it == clients_.end()) {
+        retired_.erase(connectionId);
+        return;
+    }
+    Connection& connection = it->second;
+    connection.sendInFlight = false;
+    if (result == -EAGAIN || result == -EINTR) {
+        flushIoUring(connectionId, connection);
+        return;
+    }
+    if (result < 0) {
+        auto client = connection.client;
+        if (onDisconnectCallback_) onDisconnectCallback_(client);
+        return;
+    }
+    connection.client->consumeOutput(static_cast<size_t>(result));
+    flushIoUring(connectionId, connection);
+}
+
+void Reactor::settleIoUring() {
+    // Cancel every armed operation and wait for its final completion, so the next owner
+    // of these sockets starts exactly where we stopped. Sends that still went out advance
+    // the queue, received bytes are processed, and late accepts are refused.
+    std::vector<uint64_t> targets;
+    for (const auto& [connectionId, connection] : clients_) {
+        targets.push_back((static_cast<uint64_t>(UringOp::Recv) << USER_DATA_OP_SHIFT) | connectionId);
+        if (connection.sendInFlight) {
+            targets.push_back((static_cast<uint64_t>(UringOp::Send) << USER_DATA_OP_SHIFT) | connectionId);
+        }
+    }
+    for (const auto& [connectionId, connection] : retired_) {
+        targets.push_back((static_cast<uint64_t>(UringOp::Send) << USER_DATA_OP_SHIFT) | connectionId);
+    }
+    for (int listener : listeners_) {
+        targets.push_back((static_cast<uint64_t>(UringOp::Accept) << USER_DATA_OP_SHIFT) | static_cast<uint32_t>(listener));
+    }
+    std::unordered_set<uint64_t> pending(targets.begin(), targets.end());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        io_uring_sqe* sqe = ring_->getSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = targets[i];
+        sqe->user_data = (static_cast<uint64_t>(UringOp::Cancel) << USER_DATA_OP_SHIFT) | i;
+    }
+    while (!pending.empty()) {
+        const int submitted = ring_->submitAndWait(1);
+        if (submitted < 0 && submitted != -EINTR && submitted != -EAGAIN && submitted != -EBUSY) {
+            return;
+        }
+        while (io_uring_cqe* entry = ring_->peekCqe()) {
+            const io_uring_cqe cqe = *entry;
+            ring_->advanceCq(1);
+            const auto op = static_cast<UringOp>(cqe.user_data >> USER_DATA_OP_SHIFT);
+            const uint64_t value = cqe.user_data & USER_DATA_VALUE_MASK;
+            const bool more = cqe.flags & IORING_CQE_F_MORE;
+            switch (op) {
+                case UringOp::Cancel:
+                    // Nothing left to cancel: the operation had already finished.
+                    if (cqe.res == -ENOENT) pending.erase(targets[value]);
+                    break;
+                case UringOp::Accept:
+                    if (cqe.res >= 0) close(cqe.res);
+                    if (!more) pending.erase(cqe.user_data);
+                    break;
+                case UringOp::Recv:
+                    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                        const auto bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                        auto it = clients_.find(value);
+                        if (it != clients_.end() && onInputCallback_) {
+                            auto client = it->second.client;
+                            onInputCallback_(client, ring_->getBuffer(bufferId), static_cast<size_t>(cqe.res));
+                        }
+                        ring_->recycleBuffer(bufferId);
+                    }
+                    if (!more) pending.erase(cqe.user_data);
+                    break;
+                case UringOp::Send: {
+                    pending.erase(cqe.user_data);
+                    auto it = clients_.find(value);
+                    if (it == clients_.end()) {
+                        retired_.erase(value);
+                        break;
+                    }
+                    it->second.sendInFlight = false;
+                    if (cqe.res > 0) it->second.client->consumeOutput(static_cast<size_t>(cqe.res));
+                    break;
+                }
+                case UringOp::Wakeup:
+                case UringOp::Timeout:
+                case UringOp::AcceptBackoff:
+                case UringOp::CongestionCheck:
+                    break;
+            }
+        }
+    }
+}
+
+void Reactor::detachClients() {
+    t_currentReactor = this;
+    if (ring_) {
+        settleIoUring();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        for (const auto& client : pendingRemovals_) {
+            removeClient_UNLOCKED(client);
+        }
+        pendingRemovals_.clear();
+    }
+    drainMailbox();
+    std::vector<std::shared_ptr<Client>> disconnects;
+    disconnects.swap(localDisconnects_);
+    for (const auto& client : disconnects) {
+        if (isRegistered(client) && onDisconnectCallback_) onDisconnectCallback_(client);
+    }
+    localFlushes_.clear();
+    congestedClients_.clear();
+    congestionCheckArmed_ = false;
+    for (auto& [connectionId, connection] : clients_) {
+        const auto& client = connection.client;
+        ShardStats::add<int64_t>(stats_.queuedBytes, -static_cast<int64_t>(client->getQueuedBytes()));
+        client->setShardStats(nullptr);
+        client->setReactor(nullptr, 0);
+        client->clearFlushScheduled();
+        client->setWriteBlocked(false);
+    }
+    clients_.clear();
+    clientCount_ = 0;
+    ring_.reset();
+    retired_.clear();
+    t_currentReactor = nullptr;
+}
+
+void Reactor::drain(const PayloadRef& notice, std::chrono::steady_clock::time_point deadline) {
+    t_currentReactor = this;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        for (const auto& client : pendingRemovals_) {
+            removeClient_UNLOCKED(client);
+        }
+        pendingRemovals_.clear();
+    }
+    drainMailbox();
+    for (const auto& [connectionId, connection] : clients_) {
+        connection.client->pushMessageToQueue(notice);
+    }
+    // Flushing is driven below rather than through the usual schedule.
+    for (const auto& client : localFlushes_) {
+        client->clearFlushScheduled();
+    }
+    localFlushes_.clear();
+    processDisconnects();
+    if (backend_ == IoBackend::IoUring) {
+        drainIoUring(deadline);
+    } else {
+        drainEpoll(deadline);
+    }
+    t_currentReactor = nullptr;
+}
+
+void Reactor::processDisconnects() {
+    while (!localDisconnects_.empty()) {
+        std::vector<std::shared_ptr<Client>> disconnects;
+        disconnects.swap(localDisconnects_);
+        for (const auto& client : disconnects) {
+            if (isRegistered(client) && onDisconnectCallback_) onDisconnectCallback_(client);
+        }
+    }
+}
+
+void Reactor::drainEpoll(std::chrono::steady_clock::time_point deadline) {
+    std::vector<std::shared_ptr<Client>> pending;
+    pending.reserve(clients_.size());
+    for (const auto& [connectionId, connection] : clients_) {
+        pending.push_back(connection.client);
+    }
+    epoll_event events[MAX_EVENTS];
+    for (;;) {
+        // Write to every unblocked client, then keep only those with output left.
+        std::erase_if(pending, [this](const std::shared_ptr<Client>& client) {
+            if (isRegistered(client) && !client->isWriteBlocked()) flushClient(client);
+            return !isRegistered(client) || !client->hasPendingOutput();
+        });
+        processDisconnects();
+        const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (pending.empty() || remaining.count() <= 0) return;
+        const int count = epoll_wait(epollFd_, events, MAX_EVENTS, static_cast<int>(remaining.count()));
+        if (count == -1 && errno != EINTR) return;
+        for (int i = 0; i < count; ++i) {
+            auto it = clients_.find(events[i].data.u64);
+            if (it != clients_.end() && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                it->second.client->setWriteBlocked(false);
+            }
+        }
+    }
+}
+
+void Reactor::drainIoUring(std::chrono::steady_clock::time_point deadline) {
+    for (auto& [connectionId, connection] : clients_) {
+        flushIoUring(connectionId, connection);
+    }
+    // One absolute timeout ends the wait below; the kernel copies the timespec on submit.
+    const auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch());
+    __kernel_timespec timeout{};
+    timeout.tv_sec = sinceEpoch.count() / 1000000000;
+    timeout.tv_nsec = sinceEpoch.count() % 1000000000;
+    if (io_uring_sqe* sqe = ring_->getSqe()) {
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&timeout);
+        sqe->len = 1;
+        sqe->timeout_flags = IORING_TIMEOUT_ABS;
+        sqe->user_data = static_cast<uint64_t>(UringOp::Timeout) << USER_DATA_OP_SHIFT;
+    }
+    auto sending = [this] {
+        for (const auto& [connectionId, connection] : clients_) {
+            if (connection.sendInFlight) return true;
+        }
+        return false;
+    };
+    bool expired = false;
+    while (!expired && sending()) {
+        const int submitted = ring_->submitAndWait(1);
+        if (submitted < 0 && submitted != -EINTR && submitted != -EAGAIN && submitted != -EBUSY) {
+            return;
+        }
+        while (io_uring_cqe* entry = ring_->peekCqe()) {
+            const io_uring_cqe cqe = *entry;
+            ring_->advanceCq(1);
+            const auto op = static_cast<UringOp>(cqe.user_data >> USER_DATA_OP_SHIFT);
+            if (op == UringOp::Send) {
+                handleSendCompletion(cqe.user_data & USER_DATA_VALUE_MASK, cqe.res);
+            } else if (op == UringOp::Recv && cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                ring_->recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            } else if (op == UringOp::Accept && cqe.res >= 0) {
+                close(cqe.res);
+            } else if (op == UringOp::Timeout) {
+                expired = true;
+            }
+        }
+        processDisconnects();
+    }
+}
+
+void Reactor::flushClient(const std::shared_ptr<Client>& client) {
+    if (backend_ == IoBackend::IoUring) {
+        auto it = clients_.find(client->getConnectionId());
+        if (it != clients_.end() && it->second.client == client) {
+            flushIoUring(it->first, it->second);
+        }
+        return;
+    }
+    // After a short write, wait for EPOLLOUT instead of retrying into a full socket buffer.
+    if (isRegistered(client) && !client->isWriteBlocked() && onWritableCallback_) {
+        onWritableCallback_(client);
+    }
+}
+
+void Reactor::drainMailbox() {
+    mailboxSignalled_ = false;
+    while (Delivery* delivery = mailbox_.pop()) {
+        for (Client* client : delivery->recipients) {
+            if (isRegistered(client)) {
+                client->pushMessageToQueue(delivery->message, delivery->kind);
+            }
+        }
+        delete delivery;
+    }
+}
+
+void Reactor::processPending() {
+    std::vector<std::shared_ptr<Client>> removals;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        removals.swap(pendingRemovals_);
+    }
+    for (const auto& client : removals) {
+        removeClient_UNLOCKED(client);
+    }
+    drainMailbox();
+    // Disconnects and flushes may queue more of each other (e.g. a goodbye notice), so
+    // drain until stable.
+    while (!localDisconnects_.empty() || !localFlushes_.empty()) {
+        std::vector<std::shared_ptr<Client>> disconnects;
+        disconnects.swap(localDisconnects_);
+        for (const auto& client : disconnects) {
+            if (isRegistered(client) && onDisconnectCallback_) onDisconnectCallback_(client);
+        }
+        std::vector<std::shared_ptr<Client>> flushes;
+        flushes.swap(localFlushes_);
+        for (const auto& client : flushes) {
+            client->clearFlushScheduled();
+            flushClient(client);
+        }
+    }
+}
+
+void Reactor::setOnConnectionCallback(ConnectionCallback callback) {
+    onConnectionCallback_ = std::move(callback);
+}
+
+void Reactor::setOnInputCallback(InputCallback callback) {
+    onInputCallback_ = std::move(callback);
+}
+
+void Reactor::setOnDisconnectCallback(ClientCallback callback) {
+    onDisconnectCallback_ = std::move(callback);
+}
+
+void Reactor::setOnWritableCallback(ClientCallback callback) {
+    onWritableCallback_ = std::move(callback);
+}
+
+DeliveryBatch::DeliveryBatch(PayloadRef message, std::shared_ptr<const void> keepAlive)
+    : message_(std::move(message)), keepAlive_(std::move(keepAlive)) {}
+
+void DeliveryBatch::add(Client* client) {
+    Reactor* owner = client->getReactor();
+    if (owner == nullptr || owner->isInLoopThread()) {
+        client->pushMessageToQueue(message_, MessageKind::Broadcast);
+        return;
+    }
+    for (auto& [reactor, recipients] : remote_) {
+        if (reactor == owner) {
+            recipients.push_back(client);
+            return;
+        }
+    }
+    remote_.emplace_back(owner, std::vector<Client*>{client});
+}
+
+void DeliveryBatch::dispatch() {
+    for (auto& [reactor, recipients] : remote_) {
+        reactor->post(std::move(recipients), keepAlive_, message_, MessageKind::Broadcast);
+    }
+    remote_.clear();
+}
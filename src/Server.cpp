@@ -7,11 +7,16 @@
 #include <iostream>
 #include <system_error>
 #include <stdexcept>
-#include <chrono>
-#include <thread>
+#include <algorithm>
 #include <vector>
+#include <optional>
+#include <thread>
 #include <cstring>
+#include <cstdio>
+#include <climits>
+#include <charconv>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -27,13 +32,66 @@ namespace {
         static constexpr int DEFAULT_PORT = 4040;
         static constexpr int DEFAULT_MAX_USERS = 2000;
         static constexpr int DEFAULT_MAX_CHANNELS = 1000;
-        static constexpr unsigned int DEFAULT_THREAD_POOL_SIZE = 10;
-        static constexpr size_t RECV_BUFFER_SIZE = 4096;
+        static constexpr int MIN_IO_THREADS = 1;
+        static constexpr int MAX_IO_THREADS = 256;
+        static constexpr size_t OUTPUT_IOV_MAX = IOV_MAX;
+        static constexpr int MIN_WORKER_THREADS = 1;
+        static constexpr int MAX_WORKER_THREADS = 256;
+        static constexpr long long MIN_OUTPUT_WATERMARK = 4096;
+        static constexpr int DEFAULT_HISTORY_LINES = 50;
+        static constexpr int MAX_HISTORY_LINES = 1000;
+        static constexpr long long DEFAULT_HISTORY_BUDGET = 16ll * 1024 * 1024;
+        static constexpr long long MIN_CHAT_LOG_SEGMENT_SIZE = 64ll * 1024;
+        static constexpr long long DEFAULT_CHAT_LOG_SEGMENT_SIZE = 64ll * 1024 * 1024;
+        static constexpr int DEFAULT_CHAT_LOG_SYNC_MS = 1000;
+        static constexpr std::chrono::milliseconds CHAT_LOG_INDEX_INTERVAL{1000};
+        static constexpr size_t DEFAULT_GREP_LIMIT = 100;
+        static constexpr int DEFAULT_DRAIN_TIMEOUT_MS = 300;
         static const std::string DEFAULT_SERVER_NAME;
         static const std::string DEFAULT_MOTD;
+        static const std::string DEFAULT_IO_BACKEND;
+        static const std::string DEFAULT_METRICS_ADDRESS;
     };
     const std::string ServerConfig::DEFAULT_SERVER_NAME = "Test-Server";
     const std::string ServerConfig::DEFAULT_MOTD = "Welcome to test Server!";
+    const std::string ServerConfig::DEFAULT_IO_BACKEND = "epoll";
+    const std::string ServerConfig::DEFAULT_METRICS_ADDRESS = "127.0.0.1";
+
+    int defaultIoThreads() {
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    int defaultWorkerThreads() {
+        return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    std::string escapeLabel(std::string_view value) {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string formatValue(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    void appendMetric(std::string& out, const char* name, const char* type, const char* help, double value) {
+        out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+        out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+        out += name; out += ' '; out += formatValue(value); out += '\n';
+    }
 }
 
 class ServerError : public std::runtime_error {
@@ -47,8 +105,15 @@ Server::Server()
       maxChannels_(ServerConfig::DEFAULT_MAX_CHANNELS),
       servername_(ServerConfig::DEFAULT_SERVER_NAME),
       motd_(ServerConfig::DEFAULT_MOTD),
-      listeningSocket_(-1),
-      threadPool_(ServerConfig::DEFAULT_THREAD_POOL_SIZE) {
+      ioThreads_(defaultIoThreads()),
+      ioBackend_(ServerConfig::DEFAULT_IO_BACKEND),
+      workerThreads_(defaultWorkerThreads()),
+      metricsAddress_(ServerConfig::DEFAULT_METRICS_ADDRESS),
+      historyLines_(ServerConfig::DEFAULT_HISTORY_LINES),
+      historyBudgetBytes_(ServerConfig::DEFAULT_HISTORY_BUDGET),
+      chatLogSegmentSize_(ServerConfig::DEFAULT_CHAT_LOG_SEGMENT_SIZE),
+      chatLogSyncMs_(ServerConfig::DEFAULT_CHAT_LOG_SYNC_MS),
+      drainTimeout_(ServerConfig::DEFAULT_DRAIN_TIMEOUT_MS) {
     config_ = {
         {"port", std::to_string(ServerConfig::DEFAULT_PORT)},
         {"maxchannels", std::to_string(ServerConfig::DEFAULT_MAX_CHANNELS)},
@@ -59,9 +124,7 @@ Server::Server()
     initializeManagers();
 }
 
-Server::Server(const std::string& configPath)
-    : listeningSocket_(-1),
-      threadPool_(ServerConfig::DEFAULT_THREAD_POOL_SIZE) {
+Server::Server(const std::string& configPath) {
     auto config = readConfig(configPath);
     if (!config) {
         throw ServerError("Failed to read configuration file: " + configPath);
@@ -76,6 +139,33 @@ Server::Server(const std::string& configPath)
         maxChannels_ = std::stoi(config_.at("maxchannels"));
         servername_ = config_.at("servername");
         motd_ = config_.at("motd");
+        ioThreads_ = config_.count("iothreads") ? std::stoi(config_.at("iothreads")) : 0;
+        if (ioThreads_ == 0) {
+            ioThreads_ = defaultIoThreads();
+        }
+        ioBackend_ = config_.count("iobackend") ? config_.at("iobackend") : ServerConfig::DEFAULT_IO_BACKEND;
+        workerThreads_ = config_.count("workerthreads") ? std::stoi(config_.at("workerthreads")) : 0;
+        if (workerThreads_ == 0) {
+            workerThreads_ = defaultWorkerThreads();
+        }
+        metricsPort_ = config_.count("metricsport") ? std::stoi(config_.at("metricsport")) : 0;
+        metricsAddress_ = config_.count("metricsaddress") ? config_.at("metricsaddress") : ServerConfig::DEFAULT_METRICS_ADDRESS;
+        historyLines_ = config_.count("historylines") ? std::stoi(config_.at("historylines")) : ServerConfig::DEFAULT_HISTORY_LINES;
+        const long long historyBudget = config_.count("historybudget") ? std::stoll(config_.at("historybudget")) : ServerConfig::DEFAULT_HISTORY_BUDGET;
+        if (historyBudget < 0) {
+            throw ServerError("Invalid history budget value");
+        }
+        historyBudgetBytes_ = static_cast<size_t>(historyBudget);
+        chatLogDirectory_ = config_.count("chatlogdir") ? config_.at("chatlogdir") : "";
+        const long long segmentSize = config_.count("chatlogsegmentsize") ? std::stoll(config_.at("chatlogsegmentsize")) : ServerConfig::DEFAULT_CHAT_LOG_SEGMENT_SIZE;
+        if (segmentSize < ServerConfig::MIN_CHAT_LOG_SEGMENT_SIZE) {
+            throw ServerError("Invalid chat log segment size value");
+        }
+        chatLogSegmentSize_ = static_cast<size_t>(segmentSize);
+        chatLogSyncMs_ = config_.count("chatlogsyncms") ? std::stoi(config_.at("chatlogsyncms")) : ServerConfig::DEFAULT_CHAT_LOG_SYNC_MS;
+        chatLogTokenIndex_ = config_.count("chatlogtokenindex") && std::stoi(config_.at("chatlogtokenindex")) != 0;
+        drainTimeout_ = std::chrono::milliseconds(config_.count("draintimeoutms") ? std::stoi(config_.at("draintimeoutms")) : ServerConfig::DEFAULT_DRAIN_TIMEOUT_MS);
+        readOutputPolicy();
         validateConfig();
         initializeManagers();
     } catch (const std::out_of_range& e) {
@@ -91,6 +181,36 @@ Server::~Server() {
     }
 }
 
+void Server::readOutputPolicy() {
+    auto readSize = [this](const char* key, size_t fallback) {
+        if (!config_.count(key)) return fallback;
+        const long long value = std::stoll(config_.at(key));
+        if (value < ServerConfig::MIN_OUTPUT_WATERMARK) {
+            throw ServerError(std::string("Invalid ") + key + " value");
+        }
+        return static_cast<size_t>(value);
+    };
+    outputPolicy_.highWatermark = readSize("outputhighwater", outputPolicy_.highWatermark);
+    outputPolicy_.lowWatermark = readSize("outputlowwater", std::min(outputPolicy_.lowWatermark, outputPolicy_.highWatermark / 2));
+    if (outputPolicy_.lowWatermark >= outputPolicy_.highWatermark) {
+        throw ServerError("outputlowwater must be below outputhighwater");
+    }
+    if (config_.count("slowconsumerpolicy")) {
+        auto policy = parseSlowConsumerPolicy(config_.at("slowconsumerpolicy"));
+        if (!policy) {
+            throw ServerError("Invalid slow consumer policy, expected 'drop_oldest', 'drop_nonprivate' or 'disconnect'");
+        }
+        outputPolicy_.policy = *policy;
+    }
+    if (config_.count("slowconsumertimeout")) {
+        const int timeoutMs = std::stoi(config_.at("slowconsumertimeout"));
+        if (timeoutMs < 0) {
+            throw ServerError("Invalid slow consumer timeout value");
+        }
+        outputPolicy_.disconnectAfter = std::chrono::milliseconds(timeoutMs);
+    }
+}
+
 void Server::validateConfig() {
     if (port_ < ServerConfig::MIN_PORT || port_ > ServerConfig::MAX_PORT) {
         throw ServerError("Invalid port number.");
@@ -104,149 +224,468 @@ void Server::validateConfig() {
     if (servername_.empty()) {
         throw ServerError("Server name cannot be empty");
     }
+    if (ioThreads_ < ServerConfig::MIN_IO_THREADS || ioThreads_ > ServerConfig::MAX_IO_THREADS) {
+        throw ServerError("Invalid io threads value");
+    }
+    if (ioBackend_ != "epoll" && ioBackend_ != "io_uring") {
+        throw ServerError("Invalid io backend, expected 'epoll' or 'io_uring'");
+    }
+    if (workerThreads_ < ServerConfig::MIN_WORKER_THREADS || workerThreads_ > ServerConfig::MAX_WORKER_THREADS) {
+        throw ServerError("Invalid worker threads value");
+    }
+    if (metricsPort_ != 0 && (metricsPort_ < ServerConfig::MIN_PORT || metricsPort_ > ServerConfig::MAX_PORT || metricsPort_ == port_)) {
+        throw ServerError("Invalid metrics port");
+    }
+    if (historyLines_ < 0 || historyLines_ > ServerConfig::MAX_HISTORY_LINES) {
+        throw ServerError("Invalid history lines value");
+    }
+    if (chatLogSyncMs_ < 0) {
+        throw ServerError("Invalid chat log sync interval");
+    }
+    if (drainTimeout_.count() < 0) {
+        throw ServerError("Invalid drain timeout");
+    }
 }
 
 void Server::initializeManagers() {
-    channelManager_ = std::make_unique<ChannelManager>(maxChannels_);
+    historyBudget_ = std::make_unique<HistoryBudget>(historyBudgetBytes_ > 0 ? historyLines_ : 0, historyBudgetBytes_);
+    channelManager_ = std::make_unique<ChannelManager>(maxChannels_, historyBudget_.get());
     clientManager_ = std::make_unique<ClientManager>(maxUsers_);
     messageManager_ = std::make_unique<MessageManager>(*clientManager_, *channelManager_);
     messageManager_->setMotd(motd_);
+    threadPool_ = std::make_unique<ThreadPool>(workerThreads_);
     clientManager_->setOnClientRemovedCallback([this](std::shared_ptr<Client> client) {
-        channelManager_->removeClientFromAllChannels(client);
+        if (auto* reactor = client->getReactor()) {
+            reactor->removeClient(client);
+        }
+        // Channel teardown copies every joined channel's member list, so keep it off the
+        // I/O thread; broadcasts that still reach the client are dropped by its reactor.
+        if (!threadPool_->enqueue([this, client] { channelManager_->removeClientFromAllChannels(client); }, TaskPriority::High)) {
+            channelManager_->removeClientFromAllChannels(client);
+        }
     });
 }
 
-void Server::initializeSocket() {
-    listeningSocket_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (listeningSocket_ == -1) {
+int Server::openListeningSocket() {
+    int listeningSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listeningSocket == -1) {
         throw std::system_error(errno, std::system_category(), "Failed to create socket");
     }
     int reuse = 1;
-    if (setsockopt(listeningSocket_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
-        close(listeningSocket_);
+    if (setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
+        close(listeningSocket);
         throw std::system_error(errno, std::system_category(), "Failed to set SO_REUSEADDR");
     }
-    int flags = fcntl(listeningSocket_, F_GETFL, 0);
-    if (flags == -1) {
-         close(listeningSocket_);
-        throw std::system_error(errno, std::system_category(), "Failed to get socket flags");
-    }
-    if (fcntl(listeningSocket_, F_SETFL, flags | O_NONBLOCK) == -1) {
-        close(listeningSocket_);
-        throw std::system_error(errno, std::system_category(), "Failed to set non-blocking");
+    if (setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        close(listeningSocket);
+        throw std::system_error(errno, std::system_category(), "Failed to set SO_REUSEPORT");
     }
     sockaddr_in hint{};
     hint.sin_family = AF_INET;
     hint.sin_port = htons(port_);
     hint.sin_addr.s_addr = INADDR_ANY;
-    if (bind(listeningSocket_, reinterpret_cast<sockaddr*>(&hint), sizeof(hint)) == -1) {
-        close(listeningSocket_);
+    if (bind(listeningSocket, reinterpret_cast<sockaddr*>(&hint), sizeof(hint)) == -1) {
+        close(listeningSocket);
         throw std::system_error(errno, std::system_category(), "Failed to bind socket");
     }
-    if (listen(listeningSocket_, SOMAXCONN) == -1) {
-        close(listeningSocket_);
+    if (listen(listeningSocket, SOMAXCONN) == -1) {
+        close(listeningSocket);
         throw std::system_error(errno, std::system_category(), "Failed to listen on socket");
     }
+    return listeningSocket;
+}
+
+void Server::initializeSocket(const std::vector<int>& inheritedSockets) {
+    // Listeners handed over by a warm restart are kept while they match the config.
+    for (int listeningSocket : inheritedSockets) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        const bool matches = getsockname(listeningSocket, reinterpret_cast<sockaddr*>(&address), &length) == 0 &&
+                             ntohs(address.sin_port) == port_;
+        if (matches && listeningSockets_.size() < static_cast<size_t>(ioThreads_)) {
+            listeningSockets_.push_back(listeningSocket);
+        } else {
+            close(listeningSocket);
+        }
+    }
+    // One SO_REUSEPORT listener per shard lets the kernel spread new connections
+    // across reactors; a client stays on the shard that accepted it.
+    while (listeningSockets_.size() < static_cast<size_t>(ioThreads_)) {
+        listeningSockets_.push_back(openListeningSocket());
+    }
 }
 
 void Server::start() {
+    std::optional<WarmRestart::Handoff> handoff;
     try {
         validateConfig();
-        initializeSocket();
-        running_ = true;
-        while (running_.load()) {
-            if (!canAcceptNewConnection()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
-            }
-            int clientSocket = accept(listeningSocket_, nullptr, nullptr);
-            if (clientSocket == -1) {
-                if (errno != EWOULDBLOCK && errno != EAGAIN) {
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(20));
-                continue;
-            }
-            int flags = fcntl(clientSocket, F_GETFL, 0);
-            fcntl(clientSocket, F_SETFL, flags | O_NONBLOCK);
-            auto newClient = std::make_shared<Client>(clientSocket);
-            clientManager_->addClient(newClient);
-            clientManager_->incrementTotalConnections();
-            if (!threadPool_.enqueue([this, newClient]() { this->handleClient(newClient); })) {
-                clientManager_->removeClient(newClient);
-            }
+        handoff = WarmRestart::receive();
+        initializeSocket(handoff ? handoff->state.listeningSockets : std::vector<int>{});
+        initializeReactors();
+        if (handoff) {
+            restoreState(handoff->state);
         }
+        initializeChatLog();
+        initializeMetrics();
+        if (handoff) {
+            WarmRestart::confirm(*handoff);
+            handoff.reset();
+        }
+        for (;;) {
+            runReactors();
+            if (!warmRestartRequested_.exchange(false)) break;
+            if (handOff()) return;
+        }
+        releaseServices();
+        drainClients();
+        disconnectAllClients();
     } catch (const std::exception& e) {
         stop();
+        joinReactors();
+        releaseServices();
+        // Until we confirm, the old process still serves these connections.
+        if (handoff) {
+            abandonSockets();
+        } else {
+            disconnectAllClients();
+        }
         throw;
     }
 }
 
+void Server::requestWarmRestart() {
+    if (running_.load()) {
+        warmRestartRequested_ = true;
+        stop();
+    }
+}
+
 void Server::stop() {
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
     if (running_.exchange(false)) {
-        if (listeningSocket_ != -1) {
-            shutdown(listeningSocket_, SHUT_RDWR);
-            close(listeningSocket_);
-            listeningSocket_ = -1;
+        for (const auto& reactor : reactors_) {
+            reactor->stop();
         }
-        auto clients = clientManager_->getAllClients();
-        for (const auto& client : clients) {
-            clientManager_->removeClient(client);
+        if (metricsServer_) {
+            metricsServer_->stop();
         }
     }
 }
 
-void Server::handleClient(std::shared_ptr<Client> client) {
-    try {
-        messageManager_->sendServerMessage(client, "Welcome to " + servername_ + "!");
-        messageManager_->sendServerMessage(client, "Type /help for a list of available commands.");
-        const auto clientSocket = client->getSocket();
-        std::vector<char> buffer(ServerConfig::RECV_BUFFER_SIZE);
-        while (running_.load() && clientManager_->clientExists(client)) {
-            const auto bytesReceived = recv(clientSocket, buffer.data(), buffer.size(), 0);
-            if (bytesReceived > 0) {
-                client->appendToBuffer(buffer.data(), bytesReceived);
-                if (client->getReadBuffer().length() > MAX_CLIENT_BUFFER_SIZE) {
-                    break;
-                }
-                size_t pos;
-                while ((pos = client->getReadBuffer().find('\n')) != std::string::npos) {
-                    std::string message = client->getReadBuffer().substr(0, pos);
-                    client->getReadBuffer().erase(0, pos + 1);
-                    if (!message.empty()) {
-                        messageManager_->handleMessage(client, message);
-                    }
-                }
-            } else if (bytesReceived == 0) {
-                break;
-            } else {
-                if (errno != EWOULDBLOCK && errno != EAGAIN) {
-                    break;
+void Server::initializeReactors() {
+    IoBackend backend = ioBackend_ == "io_uring" ? IoBackend::IoUring : IoBackend::Epoll;
+    for (size_t i = 0; i < listeningSockets_.size(); ++i) {
+        std::unique_ptr<Reactor> reactor;
+        if (backend == IoBackend::IoUring) {
+            try {
+                reactor = std::make_unique<Reactor>(i, backend);
+            } catch (const std::system_error& e) {
+                std::cerr << "io_uring backend unavailable (" << e.what() << "), falling back to epoll" << std::endl;
+                backend = IoBackend::Epoll;
+                ioBackend_ = "epoll";
+            }
+        }
+        if (!reactor) {
+            reactor = std::make_unique<Reactor>(i, backend);
+        }
+        Reactor* shard = reactor.get();
+        reactor->setOnConnectionCallback([this, shard](int socket) { this->acceptClient(*shard, socket); });
+        reactor->setOnInputCallback([this](const std::shared_ptr<Client>& client, const char* data, size_t length) {
+            this->handleClient(client, data, length);
+        });
+        reactor->setOnDisconnectCallback([this](const std::shared_ptr<Client>& client) { this->disconnectClient(client); });
+        reactor->setOnWritableCallback([this](const std::shared_ptr<Client>& client) { this->processClientOutput(client); });
+        reactor->addListener(listeningSockets_[i]);
+        std::lock_guard<std::mutex> lock(lifecycleMutex_);
+        reactors_.push_back(std::move(reactor));
+    }
+}
+
+void Server::initializeMetrics() {
+    if (metricsPort_ == 0) return;
+    auto metricsServer = std::make_unique<MetricsServer>(metricsAddress_, metricsPort_);
+    metricsServer->setOnScrapeCallback([this] { return renderMetrics(); });
+    if (historyService_) {
+        // GET /grep?q=words[&channel=%23name][&limit=n] searches the chat log.
+        metricsServer->setRequestHandler("/grep", [this](std::string_view query) {
+            const std::string text = MetricsServer::getQueryParameter(query, "limit");
+            size_t limit = ServerConfig::DEFAULT_GREP_LIMIT;
+            if (!text.empty()) {
+                const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), limit);
+                if (error != std::errc() || end != text.data() + text.size() || limit == 0) {
+                    throw MetricsServer::BadRequest("invalid limit");
                 }
             }
-            processClientOutput(client);
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return historyService_->grep(MetricsServer::getQueryParameter(query, "q"),
+                                         MetricsServer::getQueryParameter(query, "channel"), limit);
+        });
+    }
+    metricsServer->start();
+    std::lock_guard<std::mutex> lock(lifecycleMutex_);
+    metricsServer_ = std::move(metricsServer);
+}
+
+void Server::initializeChatLog() {
+    if (chatLogDirectory_.empty()) return;
+    chatLog_ = std::make_unique<ChatLog>(chatLogDirectory_, chatLogSegmentSize_, std::chrono::milliseconds(chatLogSyncMs_));
+    chatLog_->start();
+    messageManager_->setChatLog(chatLog_.get());
+    historyService_ = std::make_unique<HistoryService>(chatLogDirectory_, chatLogTokenIndex_, ServerConfig::CHAT_LOG_INDEX_INTERVAL);
+    historyService_->start();
+    messageManager_->setHistoryService(historyService_.get());
+}
+
+void Server::runReactors() {
+    running_ = true;
+    for (size_t i = 1; i < reactors_.size(); ++i) {
+        reactorThreads_.emplace_back([this, i] { this->runReactor(*reactors_[i]); });
+    }
+    runReactor(*reactors_[0]);
+    stop();
+    joinReactors();
+}
+
+void Server::joinReactors() {
+    for (auto& thread : reactorThreads_) {
+        thread.join();
+    }
+    reactorThreads_.clear();
+}
+
+void Server::releaseServices() {
+    {
+        std::lock_guard<std::mutex> lock(lifecycleMutex_);
+        metricsServer_.reset();
+    }
+    messageManager_->setChatLog(nullptr);
+    messageManager_->setHistoryService(nullptr);
+    historyService_.reset();
+    chatLog_.reset();
+}
+
+bool Server::handOff() {
+    // The history and chat log threads still push to clients; join them before any
+    // reactor gives its clients up.
+    releaseServices();
+    // Every reactor has stopped, so their shards are settled here one at a time.
+    for (const auto& reactor : reactors_) {
+        reactor->detachClients();
+    }
+    const auto clients = clientManager_->getAllClients();
+    ServerState state = captureState(clients);
+    {
+        std::lock_guard<std::mutex> lock(lifecycleMutex_);
+        reactors_.clear();
+    }
+    if (WarmRestart::handOff(state)) {
+        abandonSockets();
+        return true;
+    }
+    std::cerr << "Warm restart failed, resuming service" << std::endl;
+    initializeReactors();
+    for (size_t i = 0; i < clients.size(); ++i) {
+        attachClient(clients[i], state.clients[i].pendingOutput, i);
+    }
+    initializeChatLog();
+    initializeMetrics();
+    return false;
+}
+
+// Channel history is not carried over; the chat log keeps the full record.
+ServerState Server::captureState(const std::vector<std::shared_ptr<Client>>& clients) {
+    ServerState state;
+    state.listeningSockets = listeningSockets_;
+    for (const auto& channel : channelManager_->snapshotChannels()) {
+        state.channels.push_back(channel->getName());
+    }
+    state.clients.reserve(clients.size());
+    for (const auto& client : clients) {
+        ClientState& saved = state.clients.emplace_back();
+        saved.socket = client->getSocket();
+        saved.nickname = client->getNickname();
+        for (ChannelId channelId : client->getJoinedChannels()) {
+            if (auto channel = channelManager_->getChannel(channelId)) {
+                saved.channels.push_back(channel->getName());
+            }
+        }
+        if (auto active = channelManager_->getChannel(client->getActiveChannel())) {
+            saved.activeChannel = active->getName();
+        }
+        saved.pendingOutput = client->takePendingOutput();
+        saved.pendingInput = client->getInputBuffer().getPending();
+    }
+    return state;
+}
+
+void Server::restoreState(const ServerState& state) {
+    const bool blocking = reactors_.front()->getBackend() == IoBackend::IoUring;
+    std::vector<std::shared_ptr<Client>> clients;
+    clients.reserve(state.clients.size());
+    for (const auto& saved : state.clients) {
+        // Match what the accept path of our backend hands out.
+        const int flags = fcntl(saved.socket, F_GETFL);
+        fcntl(saved.socket, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+        auto client = Client::create(saved.socket);
+        client->setOutputPolicy(&outputPolicy_);
+        client->setNickname(saved.nickname);
+        client->getInputBuffer().restorePending(saved.pendingInput);
+        clients.push_back(std::move(client));
+    }
+    const size_t restored = clientManager_->restoreClients(clients);
+    for (size_t i = restored; i < clients.size(); ++i) {
+        shutdown(clients[i]->getSocket(), SHUT_RDWR);
+        close(clients[i]->getSocket());
+    }
+    clients.resize(restored);
+
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Client>>> members;
+    for (size_t i = 0; i < restored; ++i) {
+        for (const auto& channel : state.clients[i].channels) {
+            members[channel].push_back(clients[i]);
         }
-    } catch (const std::exception& e) {
     }
-    if (clientManager_->clientExists(client)) {
+    for (const auto& channel : state.channels) {
+        channelManager_->restoreChannel(channel, members[channel]);
+    }
+    for (size_t i = 0; i < restored; ++i) {
+        if (auto active = channelManager_->getChannel(state.clients[i].activeChannel)) {
+            clients[i]->setActiveChannel(active->getId());
+        }
+        attachClient(clients[i], state.clients[i].pendingOutput, i);
+    }
+}
+
+// Before the reactors run: the pending output reaches the queue through the mailbox.
+void Server::attachClient(const std::shared_ptr<Client>& client, const std::string& pendingOutput, size_t index) {
+    if (!reactors_[index % reactors_.size()]->addClient(client)) {
         clientManager_->removeClient(client);
+        return;
+    }
+    if (!pendingOutput.empty()) {
+        client->pushMessageToQueue(MessagePayload::create(pendingOutput));
+    }
+}
+
+// Another process serves these sockets now. Closing our descriptors leaves the
+// connections open, where shutdown() would end them for both.
+void Server::abandonSockets() {
+    for (int listeningSocket : listeningSockets_) {
+        close(listeningSocket);
+    }
+    listeningSockets_.clear();
+    for (const auto& client : clientManager_->getAllClients()) {
+        close(client->getSocket());
     }
 }
 
-void Server::processClientOutput(std::shared_ptr<Client> client) {
+void Server::runReactor(Reactor& reactor) {
+    try {
+        reactor.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Reactor " << reactor.getShardIndex() << " failed: " << e.what() << std::endl;
+        stop();
+    }
+}
+
+void Server::acceptClient(Reactor& reactor, int clientSocket) {
+    auto newClient = Client::create(clientSocket);
+    newClient->setOutputPolicy(&outputPolicy_);
+    if (!canAcceptNewConnection() || !reactor.addClient(newClient)) {
+        close(clientSocket);
+        return;
+    }
+    if (!clientManager_->addClient(newClient)) {
+        reactor.removeClient(newClient);
+        shutdown(clientSocket, SHUT_RDWR);
+        close(clientSocket);
+        return;
+    }
+    clientManager_->incrementTotalConnections();
+    messageManager_->sendServerMessage(newClient, "Welcome to " + servername_ + "!");
+    messageManager_->sendServerMessage(newClient, "Type /help for a list of available commands.");
+}
+
+void Server::disconnectClient(const std::shared_ptr<Client>& client) {
+    clientManager_->removeClient(client);
+}
+
+// Stops accepting, then flushes every shard's queues in parallel until the drain
+// timeout; what is still unsent by then is dropped with the sockets.
+void Server::drainClients() {
+    for (int listeningSocket : listeningSockets_) {
+        shutdown(listeningSocket, SHUT_RDWR);
+        close(listeningSocket);
+    }
+    listeningSockets_.clear();
+    if (drainTimeout_.count() <= 0 || reactors_.empty()) return;
+    const auto started = std::chrono::steady_clock::now();
+    const auto deadline = started + drainTimeout_;
+    const PayloadRef notice = MessagePayload::concat({"*** ", servername_, " is shutting down.\n"});
+    for (size_t i = 1; i < reactors_.size(); ++i) {
+        reactorThreads_.emplace_back([this, i, &notice, deadline] { reactors_[i]->drain(notice, deadline); });
+    }
+    reactors_[0]->drain(notice, deadline);
+    joinReactors();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    std::clog << "Drained client output in " << elapsed.count() << " ms" << std::endl;
+}
+
+void Server::disconnectAllClients() {
+    for (int listeningSocket : listeningSockets_) {
+        shutdown(listeningSocket, SHUT_RDWR);
+        close(listeningSocket);
+    }
+    listeningSockets_.clear();
+    clientManager_->closeAllClients();
+}
+
+void Server::handleClient(const std::shared_ptr<Client>& client, const char* data, size_t length) {
+    try {
+        const ClientId clientId = client->getId();
+        const uint64_t receivedAt = LatencyMetrics::now();
+        const auto status = client->getInputBuffer().feed(data, length, MAX_CLIENT_BUFFER_SIZE, [&](std::string_view line) {
+            if (line.empty()) return true;
+            const uint64_t parsedAt = LatencyMetrics::now();
+            LatencyMetrics::global().recordStage(LatencyStage::RecvToParsed, parsedAt - receivedAt);
+            LatencyMetrics::setLineParsedAt(parsedAt);
+            messageManager_->handleMessage(client, line);
+            LatencyMetrics::setLineParsedAt(0);
+            return clientManager_->clientExists(clientId);
+        });
+        if (status == LineBuffer::Status::LineTooLong) {
+            disconnectClient(client);
+        }
+    } catch (const std::exception& e) {
+        LatencyMetrics::setLineParsedAt(0);
+        disconnectClient(client);
+    }
+}
+
+void Server::processClientOutput(const std::shared_ptr<Client>& client) {
     const auto clientSocket = client->getSocket();
-    std::string message = client->getNextMessageFromQueue();
-    while(!message.empty()) {
-        ssize_t bytesSent = send(clientSocket, message.c_str(), message.length(), 0);
-        if (bytesSent > 0) {
-            client->popMessageFromQueue();
-        } else {
-             if (errno != EWOULDBLOCK && errno != EAGAIN) {
-                clientManager_->removeClient(client);
+    iovec iov[ServerConfig::OUTPUT_IOV_MAX];
+    while (client->hasPendingOutput()) {
+        size_t pendingBytes = 0;
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = client->gatherOutput(iov, ServerConfig::OUTPUT_IOV_MAX, &pendingBytes);
+        const ssize_t bytesSent = sendmsg(clientSocket, &message, MSG_NOSIGNAL);
+        if (bytesSent >= 0) {
+            client->consumeOutput(static_cast<size_t>(bytesSent));
+            if (static_cast<size_t>(bytesSent) < pendingBytes) {
+                // Socket buffer is full; EPOLLOUT resumes from the recorded offset.
+                client->setWriteBlocked(true);
+                return;
             }
-            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EWOULDBLOCK || errno == EAGAIN) {
+            client->setWriteBlocked(true);
+            return;
+        } else {
+            clientManager_->removeClient(client);
+            return;
         }
-        message = client->getNextMessageFromQueue();
     }
 }
 
@@ -255,19 +694,116 @@ bool Server::canAcceptNewConnection() const {
 }
 
 ServerStats Server::getStats() const {
-    return ServerStats{
-        clientManager_->getClientCount(),
-        clientManager_->getTotalConnectionsCount(),
-        messageManager_->getReceivedBytesCount(),
-        messageManager_->getSentBytesCount(),
-        threadPool_.getActiveThreadCount(),
-        threadPool_.getTaskCount()
-    };
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    ServerStats stats{};
+    stats.activeConnections = clientManager_->getClientCount();
+    stats.totalConnections = clientManager_->getTotalConnectionsCount();
+    int64_t queuedBytes = 0;
+    for (const auto& reactor : reactors_) {
+        const ShardStats& shard = reactor->getShardStats();
+        stats.closedConnections += shard.connectionsClosed.load(std::memory_order_relaxed);
+        stats.bytesReceived += shard.bytesRead.load(std::memory_order_relaxed);
+        stats.bytesSent += shard.bytesWritten.load(std::memory_order_relaxed);
+        stats.writeCalls += shard.writeCalls.load(std::memory_order_relaxed);
+        queuedBytes += shard.queuedBytes.load(std::memory_order_relaxed);
+    }
+    stats.queuedOutputBytes = static_cast<size_t>(std::max<int64_t>(queuedBytes, 0));
+    stats.messagesReceived = messageManager_->getProcessedMessagesCount();
+    stats.commandsProcessed = messageManager_->getProcessedCommandsCount();
+    stats.messagesSent = messageManager_->getSentMessagesCount();
+    stats.activeThreads = threadPool_->getActiveThreadCount();
+    stats.pendingTasks = threadPool_->getTaskCount();
+    stats.droppedBytes = outputPolicy_.droppedBytes.load();
+    stats.droppedMessages = outputPolicy_.droppedMessages.load();
+    stats.slowConsumerDisconnects = outputPolicy_.slowConsumerDisconnects.load();
+    stats.historyBytes = historyBudget_->getUsedBytes();
+    stats.historyEvictions = historyBudget_->getEvictionCount();
+    if (chatLog_) {
+        stats.chatLogRecords = chatLog_->getWrittenRecords();
+        stats.chatLogBytes = chatLog_->getWrittenBytes();
+        stats.chatLogFailedRecords = chatLog_->getFailedRecords();
+        stats.chatLogSyncs = chatLog_->getSyncCount();
+    }
+    if (historyService_) {
+        stats.chatLogIndexedRecords = historyService_->getIndexedRecords();
+        stats.chatLogIndexBytes = historyService_->getIndexMemoryUsage();
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(now - lastStatsSample_.time).count();
+    if (seconds > 0) {
+        stats.messagesReceivedPerSecond = (stats.messagesReceived - lastStatsSample_.messagesReceived) / seconds;
+        stats.messagesSentPerSecond = (stats.messagesSent - lastStatsSample_.messagesSent) / seconds;
+        stats.bytesSentPerSecond = (stats.bytesSent - lastStatsSample_.bytesSent) / seconds;
+    }
+    lastStatsSample_ = {now, stats.messagesReceived, stats.messagesSent, stats.bytesSent};
+    stats.latencies = LatencyMetrics::global().summarize();
+    return stats;
+}
+
+std::string Server::renderMetrics() const {
+    const ServerStats stats = getStats();
+    std::string out;
+    out.reserve(4096);
+    appendMetric(out, "boltchat_connections_active", "gauge", "Currently connected clients.", stats.activeConnections);
+    appendMetric(out, "boltchat_connections_total", "counter", "Accepted client connections.", stats.totalConnections);
+    appendMetric(out, "boltchat_connections_closed_total", "counter", "Closed client connections.", stats.closedConnections);
+    appendMetric(out, "boltchat_received_bytes_total", "counter", "Bytes read from client sockets.", stats.bytesReceived);
+    appendMetric(out, "boltchat_sent_bytes_total", "counter", "Bytes written to client sockets.", stats.bytesSent);
+    appendMetric(out, "boltchat_write_calls_total", "counter", "Socket write calls.", stats.writeCalls);
+    appendMetric(out, "boltchat_messages_received_total", "counter", "Lines received from clients.", stats.messagesReceived);
+    appendMetric(out, "boltchat_commands_processed_total", "counter", "Commands handled.", stats.commandsProcessed);
+    appendMetric(out, "boltchat_messages_sent_total", "counter", "Messages sent to clients or channels.", stats.messagesSent);
+    appendMetric(out, "boltchat_output_queued_bytes", "gauge", "Bytes waiting in client output queues.", stats.queuedOutputBytes);
+    appendMetric(out, "boltchat_output_dropped_bytes_total", "counter", "Output bytes dropped for slow consumers.", stats.droppedBytes);
+    appendMetric(out, "boltchat_output_dropped_messages_total", "counter", "Output messages dropped for slow consumers.", stats.droppedMessages);
+    appendMetric(out, "boltchat_slow_consumer_disconnects_total", "counter", "Clients disconnected as slow consumers.", stats.slowConsumerDisconnects);
+    appendMetric(out, "boltchat_history_bytes", "gauge", "Bytes held in channel history.", stats.historyBytes);
+    appendMetric(out, "boltchat_history_evictions_total", "counter", "Channel histories dropped to stay within the budget.", stats.historyEvictions);
+    appendMetric(out, "boltchat_chat_log_records_total", "counter", "Records appended to the chat log.", stats.chatLogRecords);
+    appendMetric(out, "boltchat_chat_log_bytes_total", "counter", "Bytes appended to the chat log.", stats.chatLogBytes);
+    appendMetric(out, "boltchat_chat_log_failed_records_total", "counter", "Chat log records lost to write errors.", stats.chatLogFailedRecords);
+    appendMetric(out, "boltchat_chat_log_syncs_total", "counter", "Chat log fsync calls.", stats.chatLogSyncs);
+    appendMetric(out, "boltchat_chat_log_indexed_records", "gauge", "Chat log records covered by the history index.", stats.chatLogIndexedRecords);
+    appendMetric(out, "boltchat_chat_log_index_bytes", "gauge", "Approximate memory held by the history index.", stats.chatLogIndexBytes);
+    appendMetric(out, "boltchat_pool_threads", "gauge", "Worker pool threads.", threadPool_->getThreadCount());
+    appendMetric(out, "boltchat_pool_active_threads", "gauge", "Worker pool threads running a task.", stats.activeThreads);
+    appendMetric(out, "boltchat_pool_pending_tasks", "gauge", "Tasks queued in the worker pool.", stats.pendingTasks);
+
+    // Member counts come from each channel's published snapshot; the registry shards are
+    // only share-locked long enough to copy the channel pointers.
+    out += "# HELP boltchat_channel_members Members per channel.\n# TYPE boltchat_channel_members gauge\n";
+    for (const auto& channel : channelManager_->snapshotChannels()) {
+        out += "boltchat_channel_members{channel=\"" + escapeLabel(channel->getName()) + "\"} ";
+        out += std::to_string(channel->getMemberCount());
+        out += '\n';
+    }
+
+    out += "# HELP boltchat_latency_seconds Latency per pipeline stage or command.\n# TYPE boltchat_latency_seconds summary\n";
+    constexpr double MICROS_PER_SECOND = 1e6;
+    for (const LatencySummary& latency : stats.latencies) {
+        const std::string labels = latency.name.starts_with("command_")
+            ? "command=\"" + escapeLabel(std::string_view(latency.name).substr(8)) + "\""
+            : "stage=\"" + latency.name + "\"";
+        const std::pair<const char*, double> quantiles[] = {
+            {"0.5", latency.p50Micros}, {"0.9", latency.p90Micros}, {"0.99", latency.p99Micros}, {"0.999", latency.p999Micros}
+        };
+        for (const auto& [quantile, micros] : quantiles) {
+            out += "boltchat_latency_seconds{" + labels + ",quantile=\"" + quantile + "\"} " + formatValue(micros / MICROS_PER_SECOND) + '\n';
+        }
+        out += "boltchat_latency_seconds_sum{" + labels + "} " + formatValue(latency.sumMicros / MICROS_PER_SECOND) + '\n';
+        out += "boltchat_latency_seconds_count{" + labels + "} " + std::to_string(latency.count) + '\n';
+    }
+    return out;
 }
 
 int Server::getPort() const { return port_; }
+int Server::getMetricsPort() const { return metricsPort_; }
 int Server::getMaxUsers() const { return maxUsers_; }
 int Server::getMaxChannels() const { return maxChannels_; }
+int Server::getIoThreads() const { return ioThreads_; }
+int Server::getWorkerThreads() const { return workerThreads_; }
+std::string Server::getIoBackend() const { return ioBackend_; }
 bool Server::isRunning() const { return running_.load(); }
 std::string Server::getServerName() const { return servername_; }
 std::string Server::getMOTD() const { return motd_; }
\ No newline at end of file
@@ -1,86 +1,142 @@
 #include "ThreadPool.h"
+#include "BlockPool.h"
 #include <stdexcept>
 #include <iostream>
 
-ThreadPool::ThreadPool(int threadCount)
-    : running_(true), activeThreads_(0) {
+namespace {
+    thread_local ThreadPool* currentPool = nullptr;
+    thread_local size_t currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(int threadCount) {
     if (threadCount <= 0)
         throw std::invalid_argument("threadCount must be greater than 0.");
 
     for (int i = 0; i < threadCount; i++) {
-        workers_.emplace_back([this] {
-            this->workerLoop();
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i]->thread = std::thread([this, i] {
+            this->workerLoop(i);
         });
     }
 }
 
 ThreadPool::~ThreadPool() {
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        std::lock_guard<std::mutex> lock(sleepMutex_);
         running_ = false;
     }
-    condition_.notify_all();
+    wakeCondition_.notify_all();
 
-    for (std::thread& worker : workers_) {
-        if (worker.joinable()) {
-            worker.join();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
         }
     }
 }
 
-void ThreadPool::workerLoop() {
-    while (true) {
-        std::function<void()> task;
-        {
-            std::unique_lock<std::mutex> lock(mutex_);
-            condition_.wait(lock, [this] {
-                return !this->running_ || !this->tasks_.empty();
-            });
-
-            if (!this->running_ && this->tasks_.empty()) {
-                return;
-            }
+bool ThreadPool::enqueue(Task task, TaskPriority priority) {
+    // Workers may still submit follow-up work while the pool drains on shutdown.
+    if (!task || (!running_.load() && currentPool != this)) {
+        return false;
+    }
+    const auto lane = static_cast<size_t>(priority);
+    // Nodes come from the per-thread block cache, so a submission takes no malloc.
+    auto* node = new (BlockPool::allocate(sizeof(Task))) Task(std::move(task));
+    pendingTasks_++;
+    if (currentPool == this) {
+        workers_[currentWorker]->deques[lane].push(node);
+    } else {
+        std::lock_guard<std::mutex> lock(injectMutex_);
+        injected_[lane].push_back(node);
+        injectedCount_[lane]++;
+    }
+    if (sleepingThreads_.load() > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex_); }
+        wakeCondition_.notify_one();
+    }
+    return true;
+}
 
-            task = std::move(this->tasks_.front());
-            this->tasks_.pop();
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    while (true) {
+        if (Task* task = takeTask(index)) {
+            pendingTasks_--;
+            runTask(task);
+            continue;
         }
-
-        if (task) {
-            activeThreads_++;
-            try {
-                task();
-            }
-            catch (const std::exception& e) {
-                std::cerr << "Exception in thread pool task: " << e.what() << std::endl;
-            }
-            catch (...) {
-                std::cerr << "Unknown exception in thread pool task" << std::endl;
-            }
-            activeThreads_--;
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepingThreads_++;
+        wakeCondition_.wait(lock, [this] {
+            return this->pendingTasks_.load() > 0 || !this->running_.load();
+        });
+        sleepingThreads_--;
+        // Drain everything that was accepted before shutting down.
+        if (!running_.load() && pendingTasks_.load() == 0) {
+            return;
         }
     }
 }
 
-bool ThreadPool::enqueue(std::function<void()> task) {
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (!running_) {
-            return false;
+Task* ThreadPool::takeTask(size_t index) {
+    for (size_t lane = 0; lane < PRIORITY_COUNT; lane++) {
+        if (Task* task = workers_[index]->deques[lane].pop()) {
+            return task;
         }
-        if (tasks_.size() >= MAX_QUEUE_SIZE) {
-            return false;
+        if (Task* task = takeInjected(lane)) {
+            return task;
+        }
+        for (size_t offset = 1; offset < workers_.size(); offset++) {
+            auto& victim = workers_[(index + offset) % workers_.size()]->deques[lane];
+            if (Task* task = victim.steal()) {
+                return task;
+            }
         }
-        tasks_.push(std::move(task));
     }
-    condition_.notify_one();
-    return true;
+    return nullptr;
+}
+
+Task* ThreadPool::takeInjected(size_t lane) {
+    if (injectedCount_[lane].load() == 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(injectMutex_);
+    if (injected_[lane].empty()) {
+        return nullptr;
+    }
+    Task* task = injected_[lane].front();
+    injected_[lane].pop_front();
+    injectedCount_[lane]--;
+    return task;
+}
+
+void ThreadPool::runTask(Task* task) {
+    activeThreads_++;
+    try {
+        (*task)();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Exception in thread pool task: " << e.what() << std::endl;
+    }
+    catch (...) {
+        std::cerr << "Unknown exception in thread pool task" << std::endl;
+    }
+    task->~Task();
+    BlockPool::deallocate(task, sizeof(Task));
+    activeThreads_--;
 }
 
 size_t ThreadPool::getTaskCount() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return tasks_.size();
+    return pendingTasks_.load();
 }
 
 size_t ThreadPool::getActiveThreadCount() const {
     return activeThreads_.load();
+}
+
+size_t ThreadPool::getThreadCount() const {
+    return workers_.size();
 }
\ No newline at end of file
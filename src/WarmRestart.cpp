@@ -0,0 +1,410 @@
+#include "WarmRestart.h"
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+    constexpr char HANDOFF_MAGIC[8] = {'B', 'C', 'H', 'A', 'N', 'D', 'O', 'F'};
+    constexpr uint32_t HANDOFF_VERSION = 1;
+    // SCM_MAX_FD: the kernel accepts at most this many descriptors per message.
+    constexpr size_t MAX_FDS_PER_MESSAGE = 253;
+    constexpr char CONFIRM_BYTE = 'R';
+
+    struct HandoffHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t socketCount;
+        uint64_t payloadSize;
+    };
+
+    // Both ends are the same build on the same host, so fields are written in host order.
+    class Encoder {
+    public:
+        void u32(uint32_t value) { raw(&value, sizeof(value)); }
+        void i32(int32_t value) { raw(&value, sizeof(value)); }
+        void str(std::string_view value) {
+            u32(static_cast<uint32_t>(value.size()));
+            raw(value.data(), value.size());
+        }
+        std::string& bytes() { return out_; }
+
+    private:
+        void raw(const void* data, size_t size) { out_.append(static_cast<const char*>(data), size); }
+        std::string out_;
+    };
+
+    class Decoder {
+    public:
+        explicit Decoder(std::string_view in) : in_(in) {}
+
+        uint32_t u32() { uint32_t value; raw(&value, sizeof(value)); return value; }
+        int32_t i32() { int32_t value; raw(&value, sizeof(value)); return value; }
+        std::string str() {
+            const uint32_t size = u32();
+            need(size);
+            std::string value(in_.substr(0, size));
+            in_.remove_prefix(size);
+            return value;
+        }
+
+    private:
+        void need(size_t size) {
+            if (in_.size() < size) {
+                throw std::system_error(EPROTO, std::system_category(), "Truncated handoff state");
+            }
+        }
+        void raw(void* data, size_t size) {
+            need(size);
+            std::memcpy(data, in_.data(), size);
+            in_.remove_prefix(size);
+        }
+        std::string_view in_;
+    };
+
+    std::string encode(const ServerState& state) {
+        Encoder encoder;
+        encoder.u32(static_cast<uint32_t>(state.listeningSockets.size()));
+        for (int socket : state.listeningSockets) {
+            encoder.i32(socket);
+        }
+        encoder.u32(static_cast<uint32_t>(state.channels.size()));
+        for (const auto& channel : state.channels) {
+            encoder.str(channel);
+        }
+        encoder.u32(static_cast<uint32_t>(state.clients.size()));
+        for (const auto& client : state.clients) {
+            encoder.i32(client.socket);
+            encoder.str(client.nickname);
+            encoder.u32(static_cast<uint32_t>(client.channels.size()));
+            for (const auto& channel : client.channels) {
+                encoder.str(channel);
+            }
+            encoder.str(client.activeChannel);
+            encoder.str(client.pendingOutput);
+            encoder.str(client.pendingInput);
+        }
+        return std::move(encoder.bytes());
+    }
+
+    ServerState decode(std::string_view payload) {
+        Decoder decoder(payload);
+        ServerState state;
+        state.listeningSockets.resize(decoder.u32());
+        for (int& socket : state.listeningSockets) {
+            socket = decoder.i32();
+        }
+        state.channels.resize(decoder.u32());
+        for (auto& channel : state.channels) {
+            channel = decoder.str();
+        }
+        state.clients.resize(decoder.u32());
+        for (auto& client : state.clients) {
+            client.socket = decoder.i32();
+            client.nickname = decoder.str();
+            client.channels.resize(decoder.u32());
+            for (auto& channel : client.channels) {
+                channel = decoder.str();
+            }
+            client.activeChannel = decoder.str();
+            client.pendingOutput = decoder.str();
+            client.pendingInput = decoder.str();
+        }
+        return state;
+    }
+
+    bool sendAll(int socket, const char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += sent;
+            size -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    bool receiveAll(int socket, char* data, size_t size) {
+        while (size > 0) {
+            const ssize_t received = recv(socket, data, size, 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0) return false;
+            data += received;
+            size -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+    // Each batch of descriptors rides on a single data byte.
+    bool sendSockets(int socket, const std::vector<int>& sockets) {
+        for (size_t first = 0; first < sockets.size(); first += MAX_FDS_PER_MESSAGE) {
+            const size_t count = std::min(MAX_FDS_PER_MESSAGE, sockets.size() - first);
+            std::vector<char> control(CMSG_SPACE(count * sizeof(int)));
+            char byte = 0;
+            iovec iov{&byte, 1};
+            msghdr message{};
+            message.msg_iov = &iov;
+            message.msg_iovlen = 1;
+            message.msg_control = control.data();
+            message.msg_controllen = control.size();
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(count * sizeof(int));
+            std::memcpy(CMSG_DATA(header), sockets.data() + first, count * sizeof(int));
+            ssize_t sent;
+            do {
+                sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+            } while (sent < 0 && errno == EINTR);
+            if (sent != 1) return false;
+        }
+        return true;
+    }
+
+    std::vector<int> receiveSockets(int socket, size_t expected) {
+        std::vector<int> sockets;
+        sockets.reserve(expected);
+        std::vector<char> control(CMSG_SPACE(MAX_FDS_PER_MESSAGE * sizeof(int)));
+        while (sockets.size() < expected) {
+            char byte;
+            iovec iov{&byte, 1};
+            msghdr message{};
+            message.msg_iov = &iov;
+            message.msg_iovlen = 1;
+            message.msg_control = control.data();
+            message.msg_controllen = control.size();
+            ssize_t received;
+            do {
+                received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+            } while (received < 0 && errno == EINTR);
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); received == 1 && header; header = CMSG_NXTHDR(&message, header)) {
+                if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) continue;
+                const size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                const size_t offset = sockets.size();
+                sockets.resize(offset + count);
+                std::memcpy(sockets.data() + offset, CMSG_DATA(header), count * sizeof(int));
+            }
+            if (received != 1 || (message.msg_flags & MSG_CTRUNC)) {
+                for (int fd : sockets) close(fd);
+                throw std::system_error(received < 0 ? errno : EPROTO, std::system_category(), "Failed to receive handed-over sockets");
+            }
+        }
+        return sockets;
+    }
+
+    // Gives every received descriptor its number from the old process, so descriptor
+    // derived names (guest nicknames) cannot collide with later connections. All of them
+    // are first moved above the highest original number to keep the targets free.
+    std::vector<int> restoreNumbers(const std::vector<int>& received, const std::vector<int>& original) {
+        const int ceiling = original.empty() ? 0 : *std::max_element(original.begin(), original.end()) + 1;
+        std::vector<int> sockets(received.size());
+        for (size_t i = 0; i < received.size(); ++i) {
+            const int moved = fcntl(received[i], F_DUPFD_CLOEXEC, ceiling);
+            if (moved == -1) {
+                sockets[i] = received[i];
+                continue;
+            }
+            close(received[i]);
+            sockets[i] = moved;
+        }
+        for (size_t i = 0; i < sockets.size(); ++i) {
+            const int target = original[i];
+            if (sockets[i] == target || fcntl(target, F_GETFD) != -1 || errno != EBADF) continue;
+            if (dup3(sockets[i], target, O_CLOEXEC) == target) {
+                close(sockets[i]);
+                sockets[i] = target;
+            }
+        }
+        return sockets;
+    }
+
+    std::vector<std::string> readCommandLine() {
+        std::ifstream file("/proc/self/cmdline", std::ios::binary);
+        const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<std::string> arguments;
+        for (size_t start = 0; start < contents.size();) {
+            const size_t end = contents.find('\0', start);
+            arguments.emplace_back(contents.substr(start, end - start));
+            if (end == std::string::npos) break;
+            start = end + 1;
+        }
+        return arguments;
+    }
+
+    // Resolved before fork(): between fork() and exec() the child of a threaded process
+    // may only make async-signal-safe calls. A path is used as given, so a binary that
+    // was replaced on disk is what gets started.
+    std::string resolveExecutable(const std::string& name) {
+        if (name.find('/') != std::string::npos) {
+            return name;
+        }
+        const char* path = std::getenv("PATH");
+        std::string_view directories = path ? path : "";
+        while (!directories.empty()) {
+            const size_t colon = directories.find(':');
+            const std::string_view directory = directories.substr(0, colon);
+            const std::string candidate = std::string(directory.empty() ? "." : directory) + "/" + name;
+            if (access(candidate.c_str(), X_OK) == 0) {
+                return candidate;
+            }
+            directories.remove_prefix(colon == std::string_view::npos ? directories.size() : colon + 1);
+        }
+        return "/proc/self/exe";
+    }
+
+    void setTimeout(int socket, int option, std::chrono::seconds timeout) {
+        timeval value{};
+        value.tv_sec = static_cast<time_t>(timeout.count());
+        setsockopt(socket, SOL_SOCKET, option, &value, sizeof(value));
+    }
+
+    pid_t spawn(int handoffSocket) {
+        const std::vector<std::string> arguments = readCommandLine();
+        if (arguments.empty()) {
+            return -1;
+        }
+        const std::string executable = resolveExecutable(arguments[0]);
+        std::vector<char*> argv;
+        for (const auto& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        const std::string prefix = std::string(WarmRestart::HANDOFF_FD_ENV) + "=";
+        const std::string handoffVariable = prefix + std::to_string(handoffSocket);
+        std::vector<char*> envp;
+        for (char** variable = environ; *variable; ++variable) {
+            if (std::strncmp(*variable, prefix.c_str(), prefix.size()) != 0) {
+                envp.push_back(*variable);
+            }
+        }
+        envp.push_back(const_cast<char*>(handoffVariable.c_str()));
+        envp.push_back(nullptr);
+
+        const pid_t pid = fork();
+        if (pid == 0) {
+            fcntl(handoffSocket, F_SETFD, 0);
+            execve(executable.c_str(), argv.data(), envp.data());
+            _exit(127);
+        }
+        return pid;
+    }
+}
+
+bool WarmRestart::handOff(const ServerState& state) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == -1) {
+        std::cerr << "Warm restart: socketpair failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const pid_t pid = spawn(pair[1]);
+    close(pair[1]);
+    if (pid == -1) {
+        std::cerr << "Warm restart: failed to start the new process: " << std::strerror(errno) << std::endl;
+        close(pair[0]);
+        return false;
+    }
+    // Neither a new process that never reads nor one that never confirms may keep the
+    // old one waiting indefinitely.
+    setTimeout(pair[0], SO_SNDTIMEO, CONFIRM_TIMEOUT);
+    setTimeout(pair[0], SO_RCVTIMEO, CONFIRM_TIMEOUT);
+
+    std::vector<int> sockets = state.listeningSockets;
+    for (const auto& client : state.clients) {
+        sockets.push_back(client.socket);
+    }
+    const std::string payload = encode(state);
+    HandoffHeader header{};
+    std::memcpy(header.magic, HANDOFF_MAGIC, sizeof(header.magic));
+    header.version = HANDOFF_VERSION;
+    header.socketCount = static_cast<uint32_t>(sockets.size());
+    header.payloadSize = payload.size();
+
+    char confirmation = 0;
+    const bool confirmed = sendAll(pair[0], reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                           sendAll(pair[0], payload.data(), payload.size()) &&
+                           sendSockets(pair[0], sockets) &&
+                           receiveAll(pair[0], &confirmation, 1) &&
+                           confirmation == CONFIRM_BYTE;
+    close(pair[0]);
+    if (!confirmed) {
+        std::cerr << "Warm restart: new process " << pid << " did not take over" << std::endl;
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        return false;
+    }
+    std::clog << "Warm restart: process " << pid << " took over " << state.clients.size() << " clients" << std::endl;
+    return true;
+}
+
+std::optional<WarmRestart::Handoff> WarmRestart::receive() {
+    const char* variable = std::getenv(HANDOFF_FD_ENV);
+    if (!variable) {
+        return std::nullopt;
+    }
+    Handoff handoff;
+    handoff.socket = std::atoi(variable);
+    unsetenv(HANDOFF_FD_ENV);
+    fcntl(handoff.socket, F_SETFD, FD_CLOEXEC);
+
+    HandoffHeader header{};
+    if (!receiveAll(handoff.socket, reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, HANDOFF_MAGIC, sizeof(header.magic)) != 0 || header.version != HANDOFF_VERSION) {
+        close(handoff.socket);
+        throw std::system_error(EPROTO, std::system_category(), "Invalid handoff header");
+    }
+    std::string payload(header.payloadSize, '\0');
+    if (!receiveAll(handoff.socket, payload.data(), payload.size())) {
+        close(handoff.socket);
+        throw std::system_error(EPROTO, std::system_category(), "Truncated handoff state");
+    }
+    std::vector<int> received;
+    try {
+        handoff.state = decode(payload);
+        received = receiveSockets(handoff.socket, header.socketCount);
+    } catch (...) {
+        close(handoff.socket);
+        throw;
+    }
+
+    std::vector<int> original = handoff.state.listeningSockets;
+    for (const auto& client : handoff.state.clients) {
+        original.push_back(client.socket);
+    }
+    if (original.size() != received.size()) {
+        for (int fd : received) close(fd);
+        close(handoff.socket);
+        throw std::system_error(EPROTO, std::system_category(), "Handoff socket count mismatch");
+    }
+    const std::vector<int> sockets = restoreNumbers(received, original);
+    const size_t listeners = handoff.state.listeningSockets.size();
+    std::copy(sockets.begin(), sockets.begin() + static_cast<std::ptrdiff_t>(listeners), handoff.state.listeningSockets.begin());
+    for (size_t i = 0; i < handoff.state.clients.size(); ++i) {
+        handoff.state.clients[i].socket = sockets[listeners + i];
+    }
+    std::clog << "Warm restart: received " << handoff.state.clients.size() << " clients and "
+              << handoff.state.channels.size() << " channels" << std::endl;
+    return handoff;
+}
+
+void WarmRestart::confirm(Handoff& handoff) {
+    if (handoff.socket == -1) return;
+    sendAll(handoff.socket, &CONFIRM_BYTE, 1);
+    close(handoff.socket);
+    handoff.socket = -1;
+}
\ No newline at end of file
@@ -3,15 +3,43 @@
 #include <memory>   // Für std::unique_ptr
 #include <vector>   // Nützlich für die Argumentenverarbeitung
 #include <csignal>  // Für die Signalbehandlung (Strg+C)
+#include <thread>
+#include <system_error>
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 #include "Server.h"
 
 std::unique_ptr<Server> g_server;
 
-void signalHandler(int signum) {
-    std::cout << "\nShutdown signal (" << signum << ") received." << std::endl;
-    if (g_server) {
-        g_server->stop();
+// Shutdown and upgrade signals are blocked in every thread and read from a signalfd
+// here, so Server::stop() and requestWarmRestart() never run in a signal handler.
+// SIGUSR2 hands all connections to a freshly started copy of the binary.
+void handleSignals(int signalFd, int quitFd) {
+    pollfd fds[2] = {{signalFd, POLLIN, 0}, {quitFd, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+        signalfd_siginfo info{};
+        if (read(signalFd, &info, sizeof(info)) != sizeof(info)) {
+            continue;
+        }
+        if (info.ssi_signo == SIGUSR2) {
+            std::cout << "Warm restart requested." << std::endl;
+            g_server->requestWarmRestart();
+        } else {
+            std::cout << "\nShutdown signal (" << info.ssi_signo << ") received." << std::endl;
+            g_server->stop();
+        }
     }
 }
 
@@ -25,8 +53,13 @@ void printUsage(const char* progName) {
 }
 
 int main(int argc, char* argv[]) {
-    signal(SIGINT, signalHandler);
-    signal(SIGTERM, signalHandler);
+    // Blocked before any thread exists, so every thread inherits the mask.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
 
     std::string configPath;
 
@@ -61,7 +94,26 @@ int main(int argc, char* argv[]) {
             g_server = std::make_unique<Server>();
         }
 
-        g_server->start();
+        const int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+        const int quitFd = eventfd(0, EFD_CLOEXEC);
+        if (signalFd == -1 || quitFd == -1) {
+            throw std::system_error(errno, std::system_category(), "Failed to set up signal handling");
+        }
+        std::thread signalThread(handleSignals, signalFd, quitFd);
+        auto stopSignalThread = [&] {
+            const uint64_t one = 1;
+            [[maybe_unused]] auto written = write(quitFd, &one, sizeof(one));
+            signalThread.join();
+            close(signalFd);
+            close(quitFd);
+        };
+        try {
+            g_server->start();
+        } catch (...) {
+            stopSignalThread();
+            throw;
+        }
+        stopSignalThread();
 
     } catch (const std::exception& e) {
         std::cerr << "A fatal error occurred during server startup or execution: " << e.what() << std::endl;
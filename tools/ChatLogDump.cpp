@@ -0,0 +1,105 @@
+// Offline reader for the chat log: prints the records of a log directory or of single
+// segment files as text, optionally filtered by channel or nickname. A torn or corrupt
+// tail (e.g. after a crash) ends that segment and is reported on stderr.
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ChatLogSegment.h"
+
+namespace {
+    struct Options {
+        std::vector<std::string> paths;
+        std::string channel;
+        std::string user;
+    };
+
+    void printUsage(const char* program) {
+        std::cout << "Usage: " << program << " [options] <log dir | segment>...\n"
+                  << "  --channel <#name>      Only messages sent to this channel\n"
+                  << "  --user <nick>          Only messages sent by or privately to this user\n";
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                return false;
+            }
+            if (arg == "--channel" || arg == "--user") {
+                if (i + 1 >= argc) return false;
+                (arg == "--channel" ? options.channel : options.user) = argv[++i];
+            } else {
+                options.paths.push_back(arg);
+            }
+        }
+        return !options.paths.empty();
+    }
+
+    bool matches(const Options& options, const ChatLogEntry& entry) {
+        const bool isChannel = entry.type == ChatLogFormat::RecordType::Channel;
+        if (!options.channel.empty() && (!isChannel || entry.target != options.channel)) {
+            return false;
+        }
+        if (!options.user.empty() && entry.sender != options.user && (isChannel || entry.target != options.user)) {
+            return false;
+        }
+        return true;
+    }
+
+    void printEntry(const ChatLogEntry& entry) {
+        const std::time_t seconds = static_cast<std::time_t>(entry.timestampMicros / 1000000);
+        std::tm utc{};
+        gmtime_r(&seconds, &utc);
+        char time[32];
+        const size_t length = std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &utc);
+        std::snprintf(time + length, sizeof(time) - length, ".%06llu", static_cast<unsigned long long>(entry.timestampMicros % 1000000));
+        std::cout << time << ' ';
+        if (entry.type == ChatLogFormat::RecordType::Channel) {
+            std::cout << '<' << entry.sender << '@' << entry.target << "> ";
+        } else {
+            std::cout << '*' << entry.sender << " -> " << entry.target << "* ";
+        }
+        std::cout << entry.text << '\n';
+    }
+
+    void dumpSegment(const Options& options, const std::string& path) {
+        const ChatLogSegment segment(path);
+        const uint64_t end = segment.forEach([&](const ChatLogEntry& entry) {
+            if (matches(options, entry)) {
+                printEntry(entry);
+            }
+            return true;
+        });
+        if (segment.getSize() > 0 && end < segment.getSize()) {
+            std::cerr << path << ": " << segment.getSize() - end << " trailing bytes are torn or corrupt" << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    try {
+        for (const auto& path : options.paths) {
+            if (std::filesystem::is_directory(path)) {
+                for (const auto& [sequence, segmentPath] : ChatLogSegment::list(path)) {
+                    dumpSegment(options, segmentPath);
+                }
+            } else {
+                dumpSegment(options, path);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file